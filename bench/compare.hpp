@@ -0,0 +1,131 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_BENCH_COMPARE_H
+#define YK_RAYTRACING_BENCH_COMPARE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "harness.hpp"
+
+// Compares a run against a stored baseline. A benchmark regresses when its
+// median slows down by more than both the relative threshold and `sigmas`
+// times the combined noise of the two runs, so a noisy kernel needs a larger
+// change to fail than a stable one. Its fastest batch must also have slowed
+// beyond the relative threshold: interference from other processes shifts
+// the median but rarely the minimum, whereas a real slowdown shifts both.
+
+namespace yk::bench {
+
+namespace detail {
+
+// the value of "key": in one object of the JSON runner::write_json() emits
+inline std::optional<std::string> field(std::string_view object,
+                                        std::string_view key) {
+  const std::string quoted = '"' + std::string(key) + "\":";
+  const auto pos = object.find(quoted);
+  if (pos == std::string_view::npos) return std::nullopt;
+  auto value = object.substr(pos + quoted.size());
+  if (value.starts_with('"')) {
+    const auto end = value.find('"', 1);
+    if (end == std::string_view::npos) return std::nullopt;
+    return std::string(value.substr(1, end - 1));
+  }
+  return std::string(value.substr(0, value.find_first_of(",}")));
+}
+
+}  // namespace detail
+
+inline std::optional<std::vector<result>> read_json(
+    const std::string& filename) {
+  std::ifstream is(filename);
+  if (!is) return std::nullopt;
+  std::stringstream ss;
+  ss << is.rdbuf();
+  const std::string text = ss.str();
+
+  std::vector<result> results;
+  for (std::size_t begin = text.find("{\"name\""); begin != std::string::npos;
+       begin = text.find("{\"name\"", begin + 1)) {
+    const std::string_view object(text.data() + begin,
+                                  text.find('}', begin) - begin);
+    const auto name = detail::field(object, "name");
+    const auto iterations = detail::field(object, "iterations");
+    const auto median = detail::field(object, "median_ns");
+    const auto mad = detail::field(object, "mad_ns");
+    const auto min = detail::field(object, "min_ns");
+    if (!name || !iterations || !median || !mad || !min) return std::nullopt;
+    results.push_back({
+        .name = *name,
+        .iterations = std::strtoull(iterations->c_str(), nullptr, 10),
+        .median_ns = std::strtod(median->c_str(), nullptr),
+        .mad_ns = std::strtod(mad->c_str(), nullptr),
+        .min_ns = std::strtod(min->c_str(), nullptr),
+    });
+  }
+  return results;
+}
+
+struct thresholds {
+  double relative = 0.05;  // slowdowns below 5 % never fail
+  double sigmas = 3.0;     // nor do those within 3 sigma of the noise
+};
+
+// Prints one row per benchmark of `current` and returns the number of
+// regressions. Benchmarks missing from the baseline are listed as new.
+inline int compare(std::ostream& os, const std::vector<result>& baseline,
+                   const std::vector<result>& current,
+                   const thresholds& limits = {}) {
+  // MAD scaled to the standard deviation of a normal distribution
+  constexpr double mad_to_sigma = 1.4826;
+
+  os << std::left << std::setw(40) << "benchmark" << std::right
+     << std::setw(14) << "baseline ns" << std::setw(14) << "current ns"
+     << std::setw(10) << "change" << std::setw(10) << "noise" << "  status\n";
+
+  int regressions = 0;
+  for (const auto& now : current) {
+    const auto before = std::ranges::find(baseline, now.name, &result::name);
+    os << std::left << std::setw(40) << now.name << std::right << std::fixed
+       << std::setprecision(2);
+    if (before == baseline.end()) {
+      os << std::setw(14) << "-" << std::setw(14) << now.median_ns
+         << std::setw(10) << "-" << std::setw(10) << "-" << "  new\n";
+      continue;
+    }
+
+    const double change = (now.median_ns - before->median_ns) /
+                          before->median_ns;
+    const double noise = limits.sigmas * mad_to_sigma *
+                         std::hypot(before->mad_ns, now.mad_ns) /
+                         before->median_ns;
+    const double bound = std::max(limits.relative, noise);
+    const double min_change = (now.min_ns - before->min_ns) / before->min_ns;
+    const char* status = "ok";
+    if (change > bound && min_change > limits.relative) {
+      status = "REGRESSION";
+      ++regressions;
+    } else if (change < -bound) {
+      status = "faster";
+    }
+    os << std::setw(14) << before->median_ns << std::setw(14)
+       << now.median_ns << std::showpos << std::setw(9) << change * 100 << '%'
+       << std::noshowpos << std::setw(9) << noise * 100 << '%' << "  "
+       << status << '\n';
+  }
+  os << std::defaultfloat;
+  return regressions;
+}
+
+}  // namespace yk::bench
+
+#endif  // !YK_RAYTRACING_BENCH_COMPARE_H
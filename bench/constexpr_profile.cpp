@@ -0,0 +1,378 @@
+// Compile-time cost of the constexpr renderer. Compiles source.cpp with
+// YK_ENABLE_CONSTEXPR over a grid of image widths and sample counts, records
+// the wall time, the peak memory of the compiler and (with -ftime-report) the
+// time spent in constant evaluation, then fits a cost per pixel-sample so the
+// size of a compile-time scene can be chosen before it is built. With
+// --objects it instead times bench/list_compile.cpp, the hit and scatter of a
+// scene of N spheres, in both the hittable_list and hittable_array layouts.
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../thirdparty/cxxopts.hpp"
+#include "../yk/render.hpp"
+
+extern char** environ;
+
+namespace {
+
+struct measurement {
+  std::uint32_t width, height, spp;
+  double wall_s;
+  double peak_mb;
+  std::optional<double> constexpr_s;  // from -ftime-report
+
+  std::uint64_t samples() const {
+    return std::uint64_t(width) * height * spp;
+  }
+};
+
+// y = intercept + slope * x by least squares
+struct linear_fit {
+  double intercept = 0, slope = 0, r2 = 0;
+
+  // the largest x with y(x) <= y, if any
+  std::optional<double> inverse(double y) const {
+    if (slope <= 0 || y < intercept) return std::nullopt;
+    return (y - intercept) / slope;
+  }
+};
+
+linear_fit fit(const std::vector<double>& x, const std::vector<double>& y) {
+  const double n = x.size();
+  double sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    sx += x[i], sy += y[i];
+    sxx += x[i] * x[i], sxy += x[i] * y[i], syy += y[i] * y[i];
+  }
+  const double vx = n * sxx - sx * sx, vy = n * syy - sy * sy;
+  const double cov = n * sxy - sx * sy;
+  if (vx == 0) return {.intercept = sy / n};
+  const double slope = cov / vx;
+  return {
+      .intercept = (sy - slope * sx) / n,
+      .slope = slope,
+      .r2 = vy == 0 ? 1 : cov * cov / (vx * vy),
+  };
+}
+
+std::vector<std::string> split(std::string_view s, char delimiter) {
+  std::vector<std::string> parts;
+  std::istringstream is{std::string(s)};
+  for (std::string part; std::getline(is, part, delimiter);)
+    if (!part.empty()) parts.push_back(part);
+  return parts;
+}
+
+std::vector<std::uint32_t> parse_list(std::string_view s) {
+  std::vector<std::uint32_t> values;
+  for (const auto& part : split(s, ','))
+    values.push_back(std::strtoul(part.c_str(), nullptr, 10));
+  return values;
+}
+
+// the wall time of the "constant expression evaluation" row of -ftime-report
+std::optional<double> constexpr_seconds(const std::string& report) {
+  std::istringstream is(report);
+  for (std::string line; std::getline(is, line);) {
+    if (line.find("constant expression evaluation") == std::string::npos)
+      continue;
+    double usr, sys, wall;
+    if (std::sscanf(line.c_str() + line.find(':') + 1,
+                    " %lf (%*[^)]) %lf (%*[^)]) %lf", &usr, &sys,
+                    &wall) == 3)
+      return wall;
+  }
+  return std::nullopt;
+}
+
+// Runs `args` with stderr sent to `log`; returns the wall time, the peak
+// resident set of the child in MiB and its exit status.
+struct run_result {
+  double wall_s, peak_mb;
+  int status;
+};
+
+std::optional<run_result> run(const std::vector<std::string>& args,
+                              const std::string& log) {
+  std::vector<char*> argv;
+  for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+  argv.push_back(nullptr);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, log.c_str(),
+                                   O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  const auto begin = std::chrono::steady_clock::now();
+  pid_t pid;
+  const int error =
+      posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (error) return std::nullopt;
+
+  // wait4 reports the usage of this child alone, unlike RUSAGE_CHILDREN
+  int status;
+  rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid) return std::nullopt;
+  const std::chrono::duration<double> wall =
+      std::chrono::steady_clock::now() - begin;
+  return run_result{wall.count(), usage.ru_maxrss / 1024.0, status};
+}
+
+std::string slurp(const std::string& filename) {
+  std::ifstream is(filename);
+  std::stringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+
+void write_table(std::ostream& os, const std::vector<measurement>& rows) {
+  os << std::setw(7) << "width" << std::setw(7) << "height" << std::setw(6)
+     << "spp" << std::setw(10) << "samples" << std::setw(10) << "wall s"
+     << std::setw(12) << "constexpr s" << std::setw(10) << "peak MiB" << '\n';
+  for (const auto& m : rows) {
+    os << std::setw(7) << m.width << std::setw(7) << m.height << std::setw(6)
+       << m.spp << std::setw(10) << m.samples() << std::fixed
+       << std::setprecision(2) << std::setw(10) << m.wall_s << std::setw(12);
+    if (m.constexpr_s)
+      os << *m.constexpr_s;
+    else
+      os << "-";
+    os << std::setw(10) << std::setprecision(1) << m.peak_mb
+       << std::defaultfloat << '\n';
+  }
+}
+
+void write_csv(std::ostream& os, const std::vector<measurement>& rows) {
+  os << "width,height,spp,samples,wall_s,constexpr_s,peak_mb\n";
+  for (const auto& m : rows) {
+    os << m.width << ',' << m.height << ',' << m.spp << ',' << m.samples()
+       << ',' << m.wall_s << ',';
+    if (m.constexpr_s) os << *m.constexpr_s;
+    os << ',' << m.peak_mb << '\n';
+  }
+}
+
+bool succeeded(const std::optional<run_result>& result) {
+  return result && WIFEXITED(result->status) &&
+         WEXITSTATUS(result->status) == 0;
+}
+
+// the cost of a scene by its number of objects, per layout
+int profile_objects(const std::vector<std::string>& compiler,
+                    const std::vector<std::uint32_t>& counts,
+                    const std::string& log) {
+  struct layout {
+    const char* name;
+    std::vector<std::string> flags;
+  };
+  // std::tuple nests one level per element, so 512 objects need a deeper
+  // template instantiation limit than the default 900
+  const layout layouts[] = {
+      {"list", {"-ftemplate-depth=4096"}},
+      {"arrays", {"-DYK_BENCH_ARRAYS"}},
+  };
+
+  std::cout << std::setw(8) << "objects" << std::setw(8) << "layout"
+            << std::setw(10) << "wall s" << std::setw(10) << "peak MiB"
+            << std::endl;
+  for (const auto& [name, flags] : layouts) {
+    std::vector<double> objects, wall;
+    for (const auto count : counts) {
+      auto args = compiler;
+      args.insert(args.end(), flags.begin(), flags.end());
+      for (const char* flag : {"-O2", "-c", "-o", "/dev/null"})
+        args.push_back(flag);
+      args.push_back("-DYK_BENCH_OBJECTS=" + std::to_string(count));
+      args.push_back("bench/list_compile.cpp");
+
+      const auto result = run(args, log);
+      if (!succeeded(result)) {
+        std::cout << "error : compilation failed\n" << slurp(log) << std::endl;
+        return EXIT_FAILURE;
+      }
+      std::cout << std::setw(8) << count << std::setw(8) << name << std::fixed
+                << std::setprecision(2) << std::setw(10) << result->wall_s
+                << std::setprecision(1) << std::setw(10) << result->peak_mb
+                << std::defaultfloat << std::endl;
+      objects.push_back(count);
+      wall.push_back(result->wall_s);
+    }
+    const auto model = fit(objects, wall);
+    std::cout << "  " << name << " : " << std::setprecision(4)
+              << model.intercept << " s + " << model.slope * 1e3
+              << " ms/object  (r^2 " << model.r2 << ")\n"
+              << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  cxxopts::Options options("constexpr_profile",
+                           "compile-time cost model of the constexpr renderer");
+
+  // clang-format off
+  options.add_options()
+      ("h,help"       , "print usage")
+      ("cxx"          , "compiler", cxxopts::value<std::string>()->default_value("g++"))
+      ("flags"        , "compiler flags, space separated", cxxopts::value<std::string>()->default_value("-std=c++20"))
+      ("source"       , "translation unit to compile", cxxopts::value<std::string>()->default_value("source.cpp"))
+      ("widths"       , "image widths, comma separated", cxxopts::value<std::string>()->default_value("8,16,32"))
+      ("spp"          , "samples per pixel, comma separated", cxxopts::value<std::string>()->default_value("1,2,4"))
+      ("time-report"  , "also record constant evaluation time (-ftime-report)")
+      ("objects"      , "time scenes of these many spheres instead, comma separated", cxxopts::value<std::string>())
+      ("budget-s"     , "compile time one translation unit may take", cxxopts::value<double>()->default_value("60"))
+      ("budget-mb"    , "memory one compiler process may take (MiB)", cxxopts::value<double>()->default_value("4096"))
+      ("csv"          , "write measurements as CSV", cxxopts::value<std::string>())
+      ;
+  // clang-format on
+
+  auto parsed = options.parse(argc, argv);
+  if (parsed.count("help")) {
+    std::cout << options.help() << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  const auto widths = parse_list(parsed["widths"].as<std::string>());
+  const auto spps = parse_list(parsed["spp"].as<std::string>());
+  const bool time_report = parsed.count("time-report");
+  if (widths.empty() || spps.empty()) {
+    std::cout << "error : no widths or samples per pixel given" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> compiler = {parsed["cxx"].as<std::string>()};
+  for (auto& flag : split(parsed["flags"].as<std::string>(), ' '))
+    compiler.push_back(std::move(flag));
+
+  char log[] = "/tmp/constexpr_profile_XXXXXX";
+  const int fd = mkstemp(log);
+  if (fd < 0) {
+    std::cout << "error : cannot create a temporary file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  close(fd);
+
+  if (parsed.count("objects")) {
+    const int status = profile_objects(
+        compiler, parse_list(parsed["objects"].as<std::string>()), log);
+    std::remove(log);
+    return status;
+  }
+
+  // syntax-only: the image is evaluated while parsing, code generation would
+  // only add a cost that does not depend on its size
+  auto base = compiler;
+  for (const char* flag :
+       {"-fsyntax-only", "-DYK_ENABLE_CONSTEXPR",
+        "-fconstexpr-ops-limit=2100000000", "-DYK_SEED=1"})
+    base.push_back(flag);
+  if (time_report) base.push_back("-ftime-report");
+
+  std::vector<measurement> rows;
+  for (const auto width : widths) {
+    for (const auto spp : spps) {
+      const auto height = yk::constants::height_of(width);
+      auto args = base;
+      args.push_back("-DYK_IMAGE_WIDTH=" + std::to_string(width));
+      args.push_back("-DYK_SPP=" + std::to_string(spp));
+      args.push_back(parsed["source"].as<std::string>());
+
+      std::cout << "compiling " << width << 'x' << height << ' ' << spp
+                << "spp" << std::endl;
+      const auto result = run(args, log);
+      if (!succeeded(result)) {
+        std::cout << "error : compilation failed\n" << slurp(log) << std::endl;
+        std::remove(log);
+        return EXIT_FAILURE;
+      }
+      rows.push_back({
+          .width = width,
+          .height = height,
+          .spp = spp,
+          .wall_s = result->wall_s,
+          .peak_mb = result->peak_mb,
+          .constexpr_s = time_report ? constexpr_seconds(slurp(log))
+                                     : std::nullopt,
+      });
+    }
+  }
+  std::remove(log);
+
+  std::cout << '\n';
+  write_table(std::cout, rows);
+
+  std::vector<double> samples, wall, memory;
+  for (const auto& m : rows) {
+    samples.push_back(m.samples());
+    wall.push_back(m.wall_s);
+    memory.push_back(m.peak_mb);
+  }
+  const auto time_model = fit(samples, wall);
+  const auto memory_model = fit(samples, memory);
+
+  std::cout << std::setprecision(4) << "\ncost model per pixel-sample\n"
+            << "  time   : " << time_model.intercept << " s + "
+            << time_model.slope * 1e3 << " ms/sample  (r^2 "
+            << time_model.r2 << ")\n"
+            << "  memory : " << memory_model.intercept << " MiB + "
+            << memory_model.slope * 1024 << " KiB/sample  (r^2 "
+            << memory_model.r2 << ")\n";
+
+  // the budgets hold per translation unit, so a scene split into N bands
+  // (CONSTEXPR_BANDS) may be about N times larger
+  const double budget_s = parsed["budget-s"].as<double>();
+  const double budget_mb = parsed["budget-mb"].as<double>();
+  const auto by_time = time_model.inverse(budget_s);
+  const auto by_memory = memory_model.inverse(budget_mb);
+  std::optional<double> affordable;
+  if (by_time && by_memory)
+    affordable = std::min(*by_time, *by_memory);
+  else
+    affordable = by_time ? by_time : by_memory;
+
+  std::cout << "\nwithin " << budget_s << " s and " << budget_mb
+            << " MiB per translation unit\n";
+  if (!affordable) {
+    std::cout << "  nothing fits the budget" << std::endl;
+  } else {
+    std::cout << "  " << std::uint64_t(*affordable) << " pixel-samples\n";
+    for (const std::uint32_t spp : {1, 4, 16, 64, 100}) {
+      std::uint32_t width = 0;
+      while (double(width + 1) * yk::constants::height_of(width + 1) * spp <=
+             *affordable)
+        ++width;
+      std::cout << "  " << std::setw(4) << spp << " spp : up to " << width
+                << 'x' << yk::constants::height_of(width) << '\n';
+    }
+    std::cout << std::flush;
+  }
+
+  if (parsed.count("csv")) {
+    std::ofstream os(parsed["csv"].as<std::string>());
+    write_csv(os, rows);
+    if (!os) {
+      std::cout << "error : cannot write csv" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_BENCH_HARNESS_H
+#define YK_RAYTRACING_BENCH_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A small self-contained benchmark harness. Each benchmark is calibrated to a
+// batch of iterations that runs for about `target`, warmed up, then timed over
+// `repetitions` batches; the report is the median time per iteration and the
+// median absolute deviation (MAD) as its noise estimate.
+
+namespace yk::bench {
+
+// keeps `value` and everything it depends on from being optimized away
+template <class T>
+inline void do_not_optimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct options {
+  int warmup = 2;
+  int repetitions = 15;
+  std::chrono::nanoseconds target = std::chrono::milliseconds(20);
+  std::string filter;  // substring of the names to run; empty runs all
+};
+
+struct result {
+  std::string name;
+  std::uint64_t iterations;  // per batch
+  double median_ns;          // per iteration
+  double mad_ns;
+  double min_ns;
+};
+
+class runner {
+ public:
+  explicit runner(options opts) : options_(std::move(opts)) {}
+
+  // `body` performs one iteration
+  template <class F>
+  void run(std::string_view name, F&& body) {
+    if (name.find(options_.filter) == std::string_view::npos) return;
+
+    const auto batch = [&](std::uint64_t iterations) {
+      const auto begin = clock::now();
+      for (std::uint64_t i = 0; i < iterations; ++i) body();
+      return std::chrono::duration<double, std::nano>(clock::now() - begin)
+          .count();
+    };
+
+    // double the batch until it takes at least a tenth of the target, then
+    // scale it to the target; the scaled batch is timed once more so a
+    // single preempted batch cannot leave it far too short
+    const double target =
+        std::chrono::duration<double, std::nano>(options_.target).count();
+    std::uint64_t iterations = 1;
+    double elapsed = batch(iterations);
+    while (elapsed < target / 10 && iterations < (std::uint64_t(1) << 40))
+      elapsed = batch(iterations *= 2);
+    for (int pass = 0; pass < 2; ++pass) {
+      iterations = std::max<std::uint64_t>(
+          1, static_cast<std::uint64_t>(iterations * target /
+                                        std::max(elapsed, 1.0)));
+      if (pass == 0) elapsed = batch(iterations);
+    }
+
+    for (int i = 0; i < options_.warmup; ++i) batch(iterations);
+
+    std::vector<double> samples;
+    for (int i = 0; i < options_.repetitions; ++i)
+      samples.push_back(batch(iterations) / iterations);
+
+    const double median = median_of(samples);
+    std::vector<double> deviations;
+    for (double s : samples) deviations.push_back(std::abs(s - median));
+    results_.push_back({
+        .name = std::string(name),
+        .iterations = iterations,
+        .median_ns = median,
+        .mad_ns = median_of(deviations),
+        .min_ns = *std::ranges::min_element(samples),
+    });
+  }
+
+  const std::vector<result>& results() const { return results_; }
+
+  void write_table(std::ostream& os) const {
+    os << std::left << std::setw(40) << "benchmark" << std::right
+       << std::setw(14) << "median ns" << std::setw(12) << "MAD ns"
+       << std::setw(14) << "min ns" << std::setw(12) << "iterations" << '\n';
+    for (const auto& r : results_)
+      os << std::left << std::setw(40) << r.name << std::right << std::fixed
+         << std::setprecision(2) << std::setw(14) << r.median_ns
+         << std::setw(12) << r.mad_ns << std::setw(14) << r.min_ns
+         << std::setw(12) << r.iterations << std::defaultfloat << '\n';
+  }
+
+  void write_csv(std::ostream& os) const {
+    os << "name,iterations,median_ns,mad_ns,min_ns\n";
+    for (const auto& r : results_)
+      os << '"' << r.name << "\"," << r.iterations << ','
+         << std::setprecision(9) << r.median_ns << ',' << r.mad_ns << ','
+         << r.min_ns << '\n';
+  }
+
+  // one benchmark object per line
+  void write_json(std::ostream& os) const {
+    os << "{\"benchmarks\":[";
+    for (std::size_t i = 0; i < results_.size(); ++i) {
+      const auto& r = results_[i];
+      os << (i ? "," : "") << "\n{\"name\":\"" << r.name
+         << "\",\"iterations\":" << r.iterations << std::setprecision(9)
+         << ",\"median_ns\":" << r.median_ns << ",\"mad_ns\":" << r.mad_ns
+         << ",\"min_ns\":" << r.min_ns << '}';
+    }
+    os << "\n]}\n";
+  }
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  static double median_of(std::vector<double> values) {
+    std::ranges::sort(values);
+    const std::size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+  }
+
+  options options_;
+  std::vector<result> results_;
+};
+
+}  // namespace yk::bench
+
+#endif  // !YK_RAYTRACING_BENCH_HARNESS_H
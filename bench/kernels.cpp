@@ -0,0 +1,380 @@
+// Microbenchmarks of the core kernels and a small end-to-end render.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../thirdparty/cxxopts.hpp"
+#include "../yk/render.hpp"
+#include "compare.hpp"
+#include "harness.hpp"
+#include "scenes.hpp"
+
+namespace {
+
+using T = double;
+using vec = yk::vec3<T>;
+using pos = yk::pos3<T, yk::world_tag>;
+
+constexpr std::size_t fixture_size = 256;  // a power of two
+
+// inputs cycle through a fixture so nothing is constant-folded
+template <class V>
+class cycle {
+ public:
+  explicit cycle(std::vector<V> values) : values_(std::move(values)) {}
+
+  const V& next() {
+    const V& v = values_[index_];
+    index_ = (index_ + 1) & (values_.size() - 1);
+    return v;
+  }
+
+ private:
+  std::vector<V> values_;
+  std::size_t index_ = 0;
+};
+
+// rays from the camera position through the default viewport
+std::vector<yk::ray<T>> make_rays(std::uint32_t seed) {
+  yk::xor128 gen(seed);
+  yk::uniform_real_distribution<T> u(-1, 1);
+  std::vector<yk::ray<T>> rays;
+  for (std::size_t i = 0; i < fixture_size; ++i)
+    rays.push_back({pos(0, 0, 0), vec(1.8 * u(gen), u(gen), -1)});
+  return rays;
+}
+
+// rays aimed at a sphere of radius 0.5 at (0, 0, -1)
+std::vector<yk::ray<T>> make_hitting_rays(std::uint32_t seed) {
+  yk::xor128 gen(seed);
+  yk::uniform_real_distribution<T> u(-0.3, 0.3);
+  std::vector<yk::ray<T>> rays;
+  for (std::size_t i = 0; i < fixture_size; ++i)
+    rays.push_back({pos(0, 0, 0), vec(u(gen), u(gen), -1)});
+  return rays;
+}
+
+// rays from the camera position towards the sphere grid of scenes.hpp
+std::vector<yk::ray<T>> make_grid_rays(std::uint32_t seed) {
+  yk::xor128 gen(seed);
+  yk::uniform_real_distribution<T> u(-0.9, 0.9);
+  std::vector<yk::ray<T>> rays;
+  for (std::size_t i = 0; i < fixture_size; ++i)
+    rays.push_back({pos(0, 0, 0), vec(u(gen), u(gen), -1)});
+  return rays;
+}
+
+// camera rays through the centers of a 16 x 16 tile of pixels of the default
+// 400-wide image, row by row
+std::vector<yk::ray<T>> make_tile_rays(std::uint32_t x0, std::uint32_t y0) {
+  constexpr std::uint32_t width = 400, height = yk::constants::height_of(400);
+  const yk::camera<T> cam;
+  std::vector<yk::ray<T>> rays;
+  for (std::uint32_t y = y0; y < y0 + 16; ++y) {
+    for (std::uint32_t x = x0; x < x0 + 16; ++x)
+      rays.push_back(cam.get_ray(T(x + 0.5) / width,
+                                 T(height - y - 1 + 0.5) / height));
+  }
+  return rays;
+}
+
+// the closest hits of the primary rays of a tile, as packets of N
+template <std::size_t N, class Scene>
+void run_packets(yk::bench::runner& runner, const std::string& name,
+                 const Scene& scene, const std::vector<yk::ray<T>>& rays) {
+  using yk::bench::do_not_optimize;
+  std::vector<yk::ray_packet<T, N>> packets(rays.size() / N);
+  for (std::size_t i = 0; i < rays.size(); ++i)
+    packets[i / N].set(i % N, rays[i]);
+  std::vector<std::array<yk::hit_candidate<T>, N>> hits(packets.size());
+  runner.run(name + " primary packets of " + std::to_string(N), [&] {
+    for (std::size_t i = 0; i < packets.size(); ++i) {
+      hits[i].fill({yk::no_hit<T>, 0});
+      scene.intersect(packets[i], 0.001, hits[i]);
+    }
+    do_not_optimize(hits.data());
+  });
+}
+
+// primary visibility of a 16 x 16 tile (256 rays) at (x0, y0), ray by ray
+// and as packets
+template <class Scene>
+void run_primary(yk::bench::runner& runner, const std::string& name,
+                 const Scene& scene, std::uint32_t x0, std::uint32_t y0) {
+  using yk::bench::do_not_optimize;
+  const auto rays = make_tile_rays(x0, y0);
+  std::vector<yk::hit_candidate<T>> hits(rays.size());
+  runner.run(name + " primary rays", [&] {
+    for (std::size_t i = 0; i < rays.size(); ++i) {
+      hits[i] = {yk::no_hit<T>, 0};
+      scene.intersect(rays[i], 0.001, hits[i]);
+    }
+    do_not_optimize(hits.data());
+  });
+  run_packets<4>(runner, name, scene, rays);
+  run_packets<8>(runner, name, scene, rays);
+  run_packets<16>(runner, name, scene, rays);
+}
+
+// hit and scatter of a scene of the sphere grid; `name` is its layout and size
+template <class Scene>
+void run_scene(yk::bench::runner& runner, const std::string& name,
+               const Scene& scene) {
+  using yk::bench::do_not_optimize;
+  {
+    cycle rays(make_grid_rays(8));
+    runner.run(name + " hit", [&] {
+      do_not_optimize(scene.hit(rays.next(), 0.001, 1e9));
+    });
+  }
+  {
+    // the closest hits of a whole fixture, ray by ray and through the buffer
+    // form of intersect()
+    const auto rays = make_grid_rays(8);
+    std::vector<yk::hit_candidate<T>> hits(rays.size());
+    runner.run(name + " intersect 256 rays", [&] {
+      for (std::size_t i = 0; i < rays.size(); ++i) {
+        hits[i] = {yk::no_hit<T>, 0};
+        scene.intersect(rays[i], 0.001, hits[i]);
+      }
+      do_not_optimize(hits.data());
+    });
+    runner.run(name + " intersect buffer 256 rays", [&] {
+      std::ranges::fill(hits, yk::hit_candidate<T>{yk::no_hit<T>, 0});
+      scene.intersect(std::span(rays), 0.001, std::span(hits));
+      do_not_optimize(hits.data());
+    });
+  }
+  {
+    std::vector<std::pair<yk::ray<T>, yk::hit_record<T>>> values;
+    for (const auto& r : make_grid_rays(9)) {
+      if (auto rec = scene.hit(r, 0.001, 1e9); rec)
+        values.emplace_back(r, *rec);
+    }
+    values.resize(fixture_size, values.front());
+    cycle hits(std::move(values));
+    yk::splitmix64 gen(10);
+    runner.run(name + " scatter", [&] {
+      const auto& [r, rec] = hits.next();
+      do_not_optimize(scene.template scatter<T>(r, rec, gen));
+    });
+  }
+}
+
+// a render() that keeps its progress messages to itself
+yk::image_t quiet_render(const yk::render_config& config) {
+  std::ostringstream sink;
+  auto* const saved = std::cout.rdbuf(sink.rdbuf());
+  yk::image_t image = yk::render(config);
+  std::cout.rdbuf(saved);
+  return image;
+}
+
+void run_all(yk::bench::runner& runner) {
+  using yk::bench::do_not_optimize;
+
+  const auto world = yk::make_world<T>();
+  const auto ball = yk::sphere(pos(0, 0, -1), 0.5,
+                               yk::lambertian<T>({0.7, 0.3, 0.3}));
+
+  {
+    cycle rays(make_hitting_rays(1));
+    runner.run("sphere::hit hit", [&] {
+      do_not_optimize(ball.hit(rays.next(), 0.001, 1e9));
+    });
+  }
+  {
+    cycle rays(make_rays(2));
+    runner.run("sphere::hit mixed", [&] {
+      do_not_optimize(ball.hit(rays.next(), 0.001, 1e9));
+    });
+    runner.run("sphere::intersect mixed", [&] {
+      yk::hit_candidate<T> closest = {1e9, 0};
+      do_not_optimize(ball.intersect(rays.next(), 0.001, closest));
+      do_not_optimize(closest);
+    });
+  }
+  {
+    cycle rays(make_rays(3));
+    runner.run("hittable_list::hit 4 spheres", [&] {
+      do_not_optimize(world.hit(rays.next(), 0.001, 1e9));
+    });
+  }
+
+  // a tile showing the ground and the centre sphere, one of the sky and one
+  // over the sphere grid
+  run_primary(runner, "world tile", world, 192, 112);
+  run_primary(runner, "world sky tile", world, 0, 0);
+  run_primary(runner, "grid arrays 512 tile",
+              yk::bench::make_grid_arrays<512, T>(), 192, 104);
+
+  run_scene(runner, "grid list 4", yk::bench::make_grid<4, T>());
+  run_scene(runner, "grid list 64", yk::bench::make_grid<64, T>());
+  run_scene(runner, "grid arrays 64", yk::bench::make_grid_arrays<64, T>());
+  run_scene(runner, "grid arrays 512", yk::bench::make_grid_arrays<512, T>());
+
+  // diffuse spheres carrying an 8 x 8 texture (1.5 KiB) each
+  using texture = yk::bench::textured<yk::color3d::value_type, 8>;
+  using metal = yk::bench::default_metal;
+  run_scene(runner, "grid list 64 textured",
+            yk::bench::make_grid<64, T, texture, metal>());
+  run_scene(runner, "grid arrays 512 textured",
+            yk::bench::make_grid_arrays<512, T, texture, metal>());
+
+  {
+    yk::mt19937 gen(42);
+    runner.run("mt19937", [&] { do_not_optimize(gen()); });
+  }
+  {
+    yk::xor128 gen(42);
+    runner.run("xor128", [&] { do_not_optimize(gen()); });
+  }
+  {
+    yk::splitmix64 gen(42);
+    runner.run("splitmix64", [&] { do_not_optimize(gen()); });
+  }
+  {
+    yk::mt19937 gen(42);
+    yk::uniform_real_distribution<T> dist(-1, 1);
+    runner.run("uniform_real_distribution mt19937",
+               [&] { do_not_optimize(dist(gen)); });
+  }
+  {
+    yk::splitmix64 gen(42);
+    yk::uniform_real_distribution<T> dist(-1, 1);
+    runner.run("uniform_real_distribution splitmix64",
+               [&] { do_not_optimize(dist(gen)); });
+  }
+
+  {
+    std::vector<T> values;
+    yk::xor128 gen(4);
+    yk::uniform_real_distribution<T> dist(1e-3, 1e3);
+    for (std::size_t i = 0; i < fixture_size; ++i) values.push_back(dist(gen));
+    cycle inputs(std::move(values));
+    runner.run("math::sqrt",
+               [&] { do_not_optimize(yk::math::sqrt(inputs.next())); });
+  }
+
+  {
+    std::vector<vec> values;
+    yk::xor128 gen(5);
+    for (std::size_t i = 0; i < fixture_size; ++i)
+      values.push_back(vec::random(gen, -1, 1));
+    cycle a(values), b(std::move(values));
+    b.next();
+    runner.run("vec3 dot", [&] { do_not_optimize(dot(a.next(), b.next())); });
+    runner.run("vec3 cross",
+               [&] { do_not_optimize(cross(a.next(), b.next())); });
+    runner.run("vec3 normalized",
+               [&] { do_not_optimize(a.next().normalized()); });
+    runner.run("vec3 reflect",
+               [&] { do_not_optimize(reflect(a.next(), b.next())); });
+  }
+
+  {
+    // hit records of rays that actually land on the scene
+    std::vector<std::pair<yk::ray<T>, yk::hit_record<T>>> values;
+    for (const auto& r : make_hitting_rays(6)) {
+      if (auto rec = ball.hit(r, 0.001, 1e9); rec)
+        values.emplace_back(r, *rec);
+    }
+    values.resize(fixture_size, values.front());
+    cycle hits(std::move(values));
+
+    const yk::lambertian<T> diffuse({0.7, 0.3, 0.3});
+    const yk::metal<T> mirror({0.8, 0.8, 0.8});
+    yk::splitmix64 gen(7);
+    runner.run("lambertian::scatter", [&] {
+      const auto& [r, rec] = hits.next();
+      do_not_optimize(diffuse.scatter(r, rec, gen));
+    });
+    runner.run("metal::scatter", [&] {
+      const auto& [r, rec] = hits.next();
+      do_not_optimize(mirror.scatter(r, rec, gen));
+    });
+  }
+
+  {
+    const yk::render_config config = {
+        .image_width = 32,
+        .image_height = yk::constants::height_of(32),
+        .samples_per_pixel = 4,
+    };
+    runner.run("render 32x18 4spp",
+               [&] { do_not_optimize(quiet_render(config).data()); });
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  cxxopts::Options options("bench_kernels", "microbenchmarks of core kernels");
+
+  // clang-format off
+  options.add_options()
+      ("h,help"       , "print usage")
+      ("filter"       , "run benchmarks whose name contains this", cxxopts::value<std::string>()->default_value(""))
+      ("repetitions"  , "timed batches per benchmark", cxxopts::value<int>()->default_value("15"))
+      ("warmup"       , "untimed batches per benchmark", cxxopts::value<int>()->default_value("2"))
+      ("batch-ms"     , "target duration of one batch (ms)", cxxopts::value<int>()->default_value("20"))
+      ("csv"          , "write results as CSV", cxxopts::value<std::string>())
+      ("json"         , "write results as JSON", cxxopts::value<std::string>())
+      ("baseline"     , "compare against this JSON and fail on regressions", cxxopts::value<std::string>())
+      ("threshold"    , "slowdown (%) below which nothing fails", cxxopts::value<double>()->default_value("5"))
+      ("sigmas"       , "slowdown (noise sigmas) below which nothing fails", cxxopts::value<double>()->default_value("3"))
+      ;
+  // clang-format on
+
+  auto parsed = options.parse(argc, argv);
+  if (parsed.count("help")) {
+    std::cout << options.help() << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  yk::bench::runner runner({
+      .warmup = parsed["warmup"].as<int>(),
+      .repetitions = std::max(1, parsed["repetitions"].as<int>()),
+      .target = std::chrono::milliseconds(parsed["batch-ms"].as<int>()),
+      .filter = parsed["filter"].as<std::string>(),
+  });
+  run_all(runner);
+  runner.write_table(std::cout);
+
+  for (const auto& [option, write] :
+       {std::pair{"csv", &yk::bench::runner::write_csv},
+        std::pair{"json", &yk::bench::runner::write_json}}) {
+    if (!parsed.count(option)) continue;
+    std::ofstream os(parsed[option].as<std::string>());
+    (runner.*write)(os);
+    if (!os) {
+      std::cout << "error : cannot write " << option << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (parsed.count("baseline")) {
+    const auto filename = parsed["baseline"].as<std::string>();
+    const auto baseline = yk::bench::read_json(filename);
+    if (!baseline) {
+      std::cout << "error : cannot read baseline " << filename << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "\ncompared with " << filename << '\n';
+    const int regressions = yk::bench::compare(
+        std::cout, *baseline, runner.results(),
+        {.relative = parsed["threshold"].as<double>() / 100,
+         .sigmas = parsed["sigmas"].as<double>()});
+    std::cout << regressions << " regression(s)" << std::endl;
+    if (regressions) return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,29 @@
+// The compile-time cost of a scene of YK_BENCH_OBJECTS spheres: one
+// translation unit that instantiates its hit and scatter, built by
+// constexpr_profile --objects. YK_BENCH_ARRAYS selects the per-material
+// hittable_array layout over a hittable_list of every sphere.
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "../yk/random.hpp"
+#include "scenes.hpp"
+
+#ifndef YK_BENCH_OBJECTS
+#define YK_BENCH_OBJECTS 4
+#endif  // !YK_BENCH_OBJECTS
+
+using T = double;
+
+std::optional<std::pair<yk::color3d, yk::ray<T>>> trace(const yk::ray<T>& r,
+                                                        std::uint64_t seed) {
+#ifdef YK_BENCH_ARRAYS
+  static const auto world = yk::bench::make_grid_arrays<YK_BENCH_OBJECTS, T>();
+#else
+  static const auto world = yk::bench::make_grid<YK_BENCH_OBJECTS, T>();
+#endif  // YK_BENCH_ARRAYS
+  yk::splitmix64 gen(seed);
+  const auto rec = world.hit(r, 0.001, 1e9);
+  if (!rec) return std::nullopt;
+  return world.template scatter<yk::color3d::value_type>(r, *rec, gen);
+}
@@ -0,0 +1,82 @@
+// Compares 4K PNG writes : stbi_write_png against yk::png::write_parallel.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../thirdparty/stb_image_write.h"
+#include "../yk/color.hpp"
+#include "../yk/png.hpp"
+#include "../yk/random.hpp"
+
+namespace {
+
+constexpr std::uint32_t width = 3840;
+constexpr std::uint32_t height = 2160;
+constexpr int repetitions = 5;
+
+// a sky-like gradient with low-spp style noise, so deflate sees the kind of
+// data the renderer produces
+std::vector<yk::color3b> make_image() {
+  std::vector<yk::color3b> image(std::size_t(width) * height);
+  yk::xor128 gen(42);
+  for (std::uint32_t y = 0; y < height; ++y)
+    for (std::uint32_t x = 0; x < width; ++x) {
+      const int t = 255 * y / height;
+      const int noise = gen() % 24;
+      image[std::size_t(y) * width + x] = {
+          .r = static_cast<std::uint8_t>(std::min(255, 128 + t / 2 + noise)),
+          .g = static_cast<std::uint8_t>(std::min(255, 178 + t / 4 + noise)),
+          .b = static_cast<std::uint8_t>(std::min(255, 230 + noise)),
+      };
+    }
+  return image;
+}
+
+double median_ms(const std::function<bool()>& write) {
+  std::vector<double> samples;
+  for (int i = 0; i < repetitions; ++i) {
+    const auto begin = std::chrono::steady_clock::now();
+    if (!write()) {
+      std::cout << "error" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - begin).count());
+  }
+  std::ranges::sort(samples);
+  return samples[samples.size() / 2];
+}
+
+}  // namespace
+
+int main() {
+  const auto image = make_image();
+  const std::string filename = "bench_png.png";
+  const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+  const double stb = median_ms([&] {
+    return stbi_write_png(filename.c_str(), width, height, 3, image.data(),
+                          3 * width) != 0;
+  });
+  const double single = median_ms([&] {
+    return yk::png::write_parallel(filename, width, height, image, 1);
+  });
+  const double parallel = median_ms([&] {
+    return yk::png::write_parallel(filename, width, height, image, threads);
+  });
+
+  std::cout << width << 'x' << height << ", median of " << repetitions
+            << " writes\n"
+            << "stbi_write_png           : " << stb << " ms\n"
+            << "write_parallel (1 thread): " << single << " ms\n"
+            << "write_parallel (" << threads << " threads): " << parallel
+            << " ms (" << stb / parallel << "x)" << std::endl;
+}
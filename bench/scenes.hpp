@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_BENCH_SCENES_H
+#define YK_RAYTRACING_BENCH_SCENES_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <random>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "../yk/color.hpp"
+#include "../yk/concepts.hpp"
+#include "../yk/hittable_array.hpp"
+#include "../yk/hittable_list.hpp"
+#include "../yk/material.hpp"
+#include "../yk/sphere.hpp"
+
+// Scenes of N small spheres on a grid in front of the camera, alternating
+// between a diffuse and a metal material, for benchmarks that scale with the
+// number of objects. make_grid() holds them in a hittable_list of N objects,
+// make_grid_arrays() in one hittable_array per material.
+
+namespace yk::bench {
+
+// A diffuse material with a Size x Size texture looked up by the normal, for
+// benchmarks of objects larger than a sphere with an albedo.
+template <concepts::arithmetic U, std::size_t Size>
+struct textured {
+  std::array<color3<U>, Size * Size> texels;
+
+  // not constexpr : GCC would fold a whole scene of textures into one
+  // constant initializer, which takes minutes to compile
+  textured(const color3<U>& albedo) { texels.fill(albedo); }
+
+  template <concepts::arithmetic T, std::uniform_random_bit_generator Gen>
+  constexpr std::optional<std::pair<color3<U>, ray<T>>> scatter(
+      const ray<T>&, const hit_record<T>& rec, Gen& gen) const {
+    const auto texel = [](T c) {
+      return std::min(Size - 1, static_cast<std::size_t>((c + 1) / 2 * Size));
+    };
+    auto scatter_direction = rec.normal + random_unit_vector<T>(gen);
+    if (scatter_direction.near_zero()) scatter_direction = rec.normal;
+    return std::make_pair(
+        texels[texel(rec.normal.y) * Size + texel(rec.normal.x)],
+        ray(rec.p, scatter_direction));
+  }
+};
+
+using default_diffuse = lambertian<color3d::value_type>;
+using default_metal = metal<color3d::value_type>;
+
+template <concepts::arithmetic T, std::size_t I, class Diffuse, class Metal>
+using grid_sphere_t = std::conditional_t<I % 2 == 0, sphere<T, Diffuse>,
+                                         sphere<T, Metal>>;
+
+// the i-th sphere, 8 x 8 per layer, layers going away from the camera
+template <class S, concepts::arithmetic T>
+constexpr S grid_sphere(std::size_t i) {
+  const pos3<T, world_tag> center(T(i % 8) - T(3.5), T(i / 8 % 8) - T(3.5),
+                                  T(-4) - T(i / 64));
+  return S(center, T(0.4), decltype(S::material)({0.7, 0.5, 0.3}));
+}
+
+template <std::size_t N, concepts::arithmetic T = double,
+          concepts::material Diffuse = default_diffuse,
+          concepts::material Metal = default_metal>
+constexpr auto make_grid() {
+  return []<std::size_t... Is>(std::index_sequence<Is...>) {
+    return hittable_list<T, grid_sphere_t<T, Is, Diffuse, Metal>...>(
+        std::tuple(
+            grid_sphere<grid_sphere_t<T, Is, Diffuse, Metal>, T>(Is)...));
+  }(std::make_index_sequence<N>());
+}
+
+template <std::size_t N, concepts::arithmetic T = double,
+          concepts::material Diffuse = default_diffuse,
+          concepts::material Metal = default_metal>
+  requires(N % 2 == 0)
+constexpr auto make_grid_arrays() {
+  return []<std::size_t... Is>(std::index_sequence<Is...>) {
+    return hittable_list<T>{}
+        .add(hittable_array<T, sphere<T, Diffuse>, N / 2>(
+            {grid_sphere<sphere<T, Diffuse>, T>(2 * Is)...}))
+        .add(hittable_array<T, sphere<T, Metal>, N / 2>(
+            {grid_sphere<sphere<T, Metal>, T>(2 * Is + 1)...}));
+  }(std::make_index_sequence<N / 2>());
+}
+
+}  // namespace yk::bench
+
+#endif  // !YK_RAYTRACING_BENCH_SCENES_H
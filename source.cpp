@@ -1,188 +1,106 @@
-#include <array>
-#include <cmath>
-#include <compare>
-#include <concepts>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
-#include <functional>
 #include <iomanip>
 #include <iostream>
-#include <limits>
-#include <numeric>
-#include <random>
-#include <ranges>
+#include <optional>
+#include <span>
 #include <string>
-#include <tuple>
-
-#if YK_ENABLE_PARALLEL
-#include <execution>
-#endif  // YK_ENABLE_PARALLEL
+#include <string_view>
+#include <vector>
 
 #include "thirdparty/cxxopts.hpp"
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "thirdparty/stb_image_write.h"
-#include "yk/camera.hpp"
-#include "yk/cartesian_product.hpp"
+#include "yk/band_pipeline.hpp"
 #include "yk/color.hpp"
 #include "yk/config.hpp"
-#include "yk/hittable.hpp"
-#include "yk/hittable_list.hpp"
-#include "yk/material.hpp"
-#include "yk/math.hpp"
-#include "yk/random.hpp"
-#include "yk/ray.hpp"
-#include "yk/sphere.hpp"
-#include "yk/vec3.hpp"
-
-#if YK_ENABLE_PARALLEL
-#define YK_EXEC_PAR std::execution::par,
-#else
-#define YK_EXEC_PAR
-#endif  // YK_ENABLE_PARALLEL
-
-#ifndef YK_IMAGE_WIDTH
-#define YK_IMAGE_WIDTH 400
-#endif  // !YK_IMAGE_WIDTH
-
-#ifndef YK_SPP
-#define YK_SPP 100
-#endif  // !YK_SPP
-
-#ifndef YK_MAX_DEPTH
-#define YK_MAX_DEPTH 50
-#endif  // !YK_MAX_DEPTH
+#include "yk/exr.hpp"
+#include "yk/framebuffer.hpp"
+#include "yk/hash.hpp"
+#include "yk/heatmap.hpp"
+#include "yk/mapped_output.hpp"
+#include "yk/png.hpp"
+#include "yk/pnm.hpp"
+#include "yk/render.hpp"
+#include "yk/stats.hpp"
+#include "yk/trace.hpp"
+
+#if YK_ENABLE_CONSTEXPR && defined(YK_CONSTEXPR_BANDS)
+#include "yk/constexpr_bands.hpp"
+// generated : declares the per-band pixels<I>() specializations
+#include "band_declarations.hpp"
+#endif  // YK_ENABLE_CONSTEXPR && YK_CONSTEXPR_BANDS
 
 namespace yk {
 
-namespace constants {
-
-constexpr double aspect_ratio = 16.0 / 9.0;
-constexpr std::uint32_t image_width = YK_IMAGE_WIDTH;
-constexpr std::uint32_t image_height =
-    static_cast<std::uint32_t>(image_width / aspect_ratio);
-constexpr std::uint32_t samples_per_pixel = YK_SPP;
-constexpr std::uint32_t max_depth = YK_MAX_DEPTH;
-
-}  // namespace constants
-
-using color = color3d;
-
-using image_t =
-    std::array<color3b, constants::image_width * constants::image_height>;
-
-template <concepts::arithmetic T>
-constexpr color3b to_color3b(const color3<T>& from,
-                             std::uint32_t samples_per_pixel) {
-  auto [r, g, b] = from / samples_per_pixel;
-  color3<T> color = {
-      .r = math::sqrt(r),
-      .g = math::sqrt(g),
-      .b = math::sqrt(b),
-  };
-  return (color.clamped(0.0, 0.999) * 256).template to<uint8_t>();
-}
+enum class output_format { png, ppm, pfm, exr, raw };
 
-template <std::ranges::input_range R, std::copy_constructible F>
-constexpr auto for_each(R&& range, F func) {
-  return std::for_each(YK_EXEC_PAR std::ranges::begin(range),
-                       std::ranges::end(range), func);
+constexpr std::optional<output_format> parse_output_format(
+    std::string_view name) {
+  if (name == "png") return output_format::png;
+  if (name == "ppm") return output_format::ppm;
+  if (name == "pfm") return output_format::pfm;
+  if (name == "exr") return output_format::exr;
+  if (name == "raw") return output_format::raw;
+  return std::nullopt;
 }
 
-template <std::ranges::input_range R, class T, std::copy_constructible BinOp,
-          std::invocable<std::ranges::range_value_t<R>> UnaryOp>
-constexpr T transform_reduce(R&& r, T init, BinOp bin_op, UnaryOp unary_op) {
-  return std::transform_reduce(YK_EXEC_PAR std::ranges::begin(r),
-                               std::ranges::end(r), init, bin_op, unary_op);
+// float formats need the accumulation plane
+constexpr bool is_hdr(output_format format) {
+  return format == output_format::pfm || format == output_format::exr;
 }
 
-template <concepts::arithmetic T = double>
-constexpr image_t render() {
-  const raytracer<T, double> tracer = {};
-  const camera<T> cam = {};
-
-  const auto world =
-      hittable_list<T>{}
-          .add(sphere(pos3<T, world_tag>(0, 0, -1), 0.5,
-                      lambertian<color::value_type>({0.7, 0.3, 0.3})))
-          .add(sphere(pos3<T, world_tag>(0, -100.5, -1), 100.0,
-                      lambertian<color::value_type>({0.8, 0.8, 0.0})))
-          .add(sphere(pos3<T, world_tag>(-1.0, 0.0, -1.0), 0.5,
-                      metal<color::value_type>({0.8, 0.8, 0.8})))
-          .add(sphere(pos3<T, world_tag>(1.0, 0.0, -1.0), 0.5,
-                      metal<color::value_type>({0.8, 0.6, 0.2})));
-
-  if (!std::is_constant_evaluated()) std::cout << "rendering..." << std::endl;
-
-  image_t image = {};
-
-  constexpr std::string_view time = __TIME__;
-  constexpr std::uint32_t constexpr_seed =
-      std::accumulate(time.begin(), time.end(), std::uint32_t(0));
-
-  for_each(
-      views::cartesian_product(std::views::iota(0u, constants::image_height),
-                               std::views::iota(0u, constants::image_width)),
-      [&](auto yx) {
-        const auto& [y, x] = yx;
-
-        if (!std::is_constant_evaluated() && verbose)
-          std::cout << "(row,col) : " << '('
-                    << std::setw(
-                           std::ceil(std::log10(constants::image_height)) - 1)
-                    << y << ','
-                    << std::setw(std::ceil(std::log10(constants::image_width)) -
-                                 1)
-                    << x << ')' << std::endl;
-
-        color pixel_color = transform_reduce(
-            std::views::iota(0u, constants::samples_per_pixel), color(0, 0, 0),
-            std::plus{}, [&](auto s) {
-              if (!std::is_constant_evaluated() && verbose > 1)
-                std::cout
-                    << "(row,col,sam) : " << '('
-                    << std::setw(
-                           std::ceil(std::log10(constants::image_height)) - 1)
-                    << y << ','
-                    << std::setw(std::ceil(std::log10(constants::image_width)) -
-                                 1)
-                    << x << ','
-                    << std::setw(
-                           std::ceil(std::log10(constants::samples_per_pixel)) -
-                           1)
-                    << s << ')' << std::endl;
-
-              mt19937 gen(std::is_constant_evaluated()
-                              ? constexpr_seed +
-                                    (y * constants::image_width + x) *
-                                        constants::samples_per_pixel +
-                                    s
-                              : std::random_device{}());
-              uniform_real_distribution<T> dist(0, 1);
-
-              auto u = (x + dist(gen)) / constants::image_width;
-              auto v = (constants::image_height - y - 1 + dist(gen)) /
-                       constants::image_height;
-              return tracer.ray_color(cam.get_ray(u, v), world,
-                                      constants::max_depth, gen);
-            });
-
-        // parallel access to different element in the same vector is safe
-        image[y * constants::image_width + x] =
-            to_color3b(pixel_color, constants::samples_per_pixel);
-      });
-
-  if (!std::is_constant_evaluated())
-    std::cout << "rendering finished" << std::endl;
-
-  return image;
+constexpr std::optional<mapped_layout> mapped_layout_of(output_format format) {
+  switch (format) {
+    case output_format::ppm:
+      return mapped_layout::ppm;
+    case output_format::pfm:
+      return mapped_layout::pfm;
+    case output_format::raw:
+      return mapped_layout::raw;
+    default:
+      return std::nullopt;
+  }
 }
 
-void print_ppm(const image_t& image) {
-  std::cout << "P3" << '\n'
-            << constants::image_width << ' ' << constants::image_height << '\n'
-            << 255 << '\n';
-  for (const auto& [r, g, b] : image)
-    std::cout << +r << ' ' << +g << ' ' << +b << '\n';
+struct output_options {
+  output_format format = output_format::png;
+  unsigned png_threads = 0;
+  exr::pixel_type exr_type = exr::pixel_type::half;
+  exr::compression exr_compression = exr::compression::zip;
+};
+
+// `samples_per_pixel` normalizes the float accumulation for HDR output
+bool write_image(const std::string& filename, const image_t& image,
+                 const render_config& config,
+                 [[maybe_unused]] std::uint32_t samples_per_pixel,
+                 const output_options& options) {
+  const trace::scope scope("write image");
+  switch (options.format) {
+    case output_format::ppm:
+      return pnm::write_ppm(filename, config.image_width, config.image_height,
+                            {image.data(), image.size()});
+    case output_format::raw:
+      return pnm::write_raw(filename, {image.data(), image.size()});
+#if YK_ENABLE_CONSTEXPR
+    case output_format::pfm:
+    case output_format::exr:
+      // the compile-time image has no float accumulation
+      return false;
+#else
+    case output_format::pfm:
+      return pnm::write_pfm(filename, config.image_width, config.image_height,
+                            image.accumulation(), 1.0f / samples_per_pixel);
+    case output_format::exr:
+      return exr::write(filename, config.image_width, config.image_height,
+                        image.accumulation(), 1.0f / samples_per_pixel,
+                        options.exr_type, options.exr_compression);
+#endif  // YK_ENABLE_CONSTEXPR
+    case output_format::png:
+      break;
+  }
+  return png::write_parallel(filename, config.image_width,
+                             config.image_height, {image.data(), image.size()},
+                             options.png_threads);
 }
 
 }  // namespace yk
@@ -196,12 +114,41 @@ int main(int argc, char* argv[]) {
   // handle command line args
   cxxopts::Options options("raytrace", "raytracing program");
 
+  const auto uint_value = [](std::uint32_t default_value) {
+    return cxxopts::value<std::uint32_t>()->default_value(
+        std::to_string(default_value));
+  };
+
   // clang-format off
   options.add_options()
       ("h,help"         , "print usage")
       ("v,verbose"      , "verbose output")
       ("o,output"       , "filename of output", cxxopts::value<std::string>())
-      ("l,verbose-level", "set verbose level" , cxxopts::value<std::vector<std::uint32_t>>());
+      ("l,verbose-level", "set verbose level" , cxxopts::value<std::vector<std::uint32_t>>())
+      ("f,format"       , "output format : png, ppm, pfm, exr or raw", cxxopts::value<std::string>()->default_value("png"))
+      ("png-threads"    , "PNG compression threads (0 : all)", uint_value(0))
+      ("exr-float"      , "write 32-bit float EXR channels instead of half")
+      ("exr-uncompressed", "write EXR without ZIP compression")
+      ("trace"          , "write a Chrome trace of the run", cxxopts::value<std::string>())
+      ("hash"           , "print a digest of the rendered image")
+#if !YK_ENABLE_CONSTEXPR
+      ("mmap"           , "render straight into the mapped ppm/pfm/raw file")
+      ("fsync"          , "flush the --mmap output to disk before exiting")
+      ("stats"          , "print ray counters and Mrays/s")
+      ("heatmap"        , "also write a false-color PNG of per-pixel cost", cxxopts::value<std::string>())
+      ("heatmap-metric" , "heatmap cost : cycles, rays or tests", cxxopts::value<std::string>()->default_value("cycles"))
+#endif  // !YK_ENABLE_CONSTEXPR
+#if !YK_ENABLE_CONSTEXPR
+      ("w,width"        , "image width (16:9)", uint_value(yk::constants::image_width))
+      ("s,spp"          , "samples per pixel" , uint_value(yk::constants::samples_per_pixel))
+      ("d,max-depth"    , "max ray bounces"   , uint_value(yk::constants::max_depth))
+      ("t,time-budget"  , "render progressively within the budget (ms)", cxxopts::value<std::uint32_t>())
+      ("seed"           , "render deterministically from this seed", cxxopts::value<std::uint64_t>())
+      ("huge-pages"     , "back the framebuffer with huge pages")
+      ("stream"         , "encode PNG row bands while rendering")
+      ("band-height"    , "rows per band for --stream", uint_value(16))
+#endif  // !YK_ENABLE_CONSTEXPR
+      ;
   // clang-format on
 
   options.parse_positional({"output", "positional"});
@@ -217,15 +164,188 @@ int main(int argc, char* argv[]) {
 
   filename = parsed["output"].as<std::string>();
 
+  if (parsed.count("trace")) yk::trace::enable();
+  const auto write_trace = [&] {
+    if (!parsed.count("trace")) return;
+    const auto trace_filename = parsed["trace"].as<std::string>();
+    std::cout << "write trace : " << trace_filename << std::endl;
+    if (!yk::trace::write(trace_filename)) {
+      std::cout << "error" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  };
+
+  const auto format =
+      yk::parse_output_format(parsed["format"].as<std::string>());
+  if (!format) {
+    std::cout << "error : unknown format" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+#if YK_ENABLE_CONSTEXPR
+  if (yk::is_hdr(*format)) {
+    std::cout << "error : float output needs the runtime build" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+#endif  // YK_ENABLE_CONSTEXPR
+
+  yk::output_options output = {
+      .format = *format,
+      .png_threads = parsed["png-threads"].as<std::uint32_t>(),
+  };
+  if (parsed.count("exr-float")) output.exr_type = yk::exr::pixel_type::single;
+  if (parsed.count("exr-uncompressed"))
+    output.exr_compression = yk::exr::compression::none;
+
   // rendering
-  YK_CONSTEXPR yk::image_t image = yk::render();
+#if YK_ENABLE_CONSTEXPR
+  constexpr yk::render_config config = {};
+#ifdef YK_CONSTEXPR_BANDS
+  static const yk::image_t image = yk::constexpr_bands::stitch();
+#else
+  constexpr yk::image_t image = yk::render(config);
+#endif  // YK_CONSTEXPR_BANDS
+  constexpr std::uint32_t samples_per_pixel = config.samples_per_pixel;
+#else
+  yk::render_config config = {};
+  config.image_width = parsed["width"].as<std::uint32_t>();
+  config.image_height = yk::constants::height_of(config.image_width);
+  config.samples_per_pixel = parsed["spp"].as<std::uint32_t>();
+  config.max_depth = parsed["max-depth"].as<std::uint32_t>();
+  if (parsed.count("seed")) config.seed = parsed["seed"].as<std::uint64_t>();
+  if (parsed.count("huge-pages"))
+    config.backing = yk::framebuffer_backing::huge_pages;
+  if (config.image_width == 0 || config.image_height == 0 ||
+      config.samples_per_pixel == 0) {
+    std::cout << "error : image size and spp must be positive" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  const auto render_begin = std::chrono::steady_clock::now();
+  const auto report_stats = [&] {
+    if (parsed.count("stats"))
+      yk::stats::print(std::cout, yk::stats::merge(),
+                       std::chrono::steady_clock::now() - render_begin);
+  };
+
+  if (parsed.count("hash") &&
+      (parsed.count("mmap") || parsed.count("stream"))) {
+    std::cout << "error : --hash needs an in-memory render" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::optional<yk::heatmap::metric> heatmap_metric;
+  if (parsed.count("heatmap")) {
+    heatmap_metric = yk::heatmap::parse_metric(
+        parsed["heatmap-metric"].as<std::string>());
+    if (!heatmap_metric) {
+      std::cout << "error : unknown heatmap metric" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    if (parsed.count("mmap") || parsed.count("stream") ||
+        parsed.count("time-budget")) {
+      std::cout << "error : --heatmap needs a fixed-spp in-memory render"
+                << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if (parsed.count("mmap")) {
+    const auto layout = yk::mapped_layout_of(*format);
+    if (!layout || parsed.count("time-budget") || parsed.count("stream")) {
+      std::cout << "error : --mmap only supports fixed-spp ppm/pfm/raw output"
+                << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    std::cout << "map file : " << filename << std::endl;
+    yk::mapped_output mapped(filename, *layout, config.image_width,
+                             config.image_height);
+    if (!mapped.good()) {
+      std::cout << "error" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    yk::render_mapped(mapped, config);
+    report_stats();
+    if (!mapped.close(parsed.count("fsync"))) {
+      std::cout << "error" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    std::cout << "success" << std::endl;
+    write_trace();
+    return EXIT_SUCCESS;
+  }
+
+  if (parsed.count("stream")) {
+    if (parsed.count("time-budget") || *format != yk::output_format::png) {
+      std::cout << "error : --stream only supports fixed-spp png output"
+                << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    std::cout << "stream to file : " << filename << std::endl;
+    yk::png::stream_writer writer(filename, config.image_width,
+                                  config.image_height);
+    {
+      yk::band_pipeline pipeline(
+          config.image_width,
+          std::max(parsed["band-height"].as<std::uint32_t>(), 1u),
+          [&](std::uint32_t first_row, std::span<const yk::color3b> rows) {
+            const yk::trace::scope scope("png band", first_row);
+            writer.write_rows(rows);
+          },
+          config.backing);
+      yk::render_bands(pipeline, config);
+    }
+    report_stats();
+    if (!writer.finish()) {
+      std::cout << "error" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    std::cout << "success" << std::endl;
+    write_trace();
+    return EXIT_SUCCESS;
+  }
+
+  yk::image_t image;
+  std::uint32_t samples_per_pixel = config.samples_per_pixel;
+  std::vector<float> cost(heatmap_metric ? config.pixel_count() : 0);
+  if (parsed.count("time-budget")) {
+    auto result = yk::render_progressive(
+        std::chrono::milliseconds(parsed["time-budget"].as<std::uint32_t>()),
+        config);
+    std::cout << "achieved samples per pixel : " << result.samples_per_pixel
+              << std::endl;
+    image = std::move(result.image);
+    samples_per_pixel = result.samples_per_pixel;
+  } else {
+    image = yk::render(config, {.metric = heatmap_metric.value_or(
+                                    yk::heatmap::metric::cycles),
+                                .cost = cost});
+  }
+  report_stats();
+
+  if (heatmap_metric) {
+    const auto heatmap_filename = parsed["heatmap"].as<std::string>();
+    std::cout << "write heatmap : " << heatmap_filename << " (full scale "
+              << yk::heatmap::normalizer(cost) << ')' << std::endl;
+    if (!yk::png::write_parallel(heatmap_filename, config.image_width,
+                                 config.image_height,
+                                 yk::heatmap::false_color(cost),
+                                 output.png_threads)) {
+      std::cout << "error" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+#endif  // YK_ENABLE_CONSTEXPR
+
+  if (parsed.count("hash"))
+    std::cout << "hash : " << std::hex << std::setw(16) << std::setfill('0')
+              << yk::hash::fnv1a({image.data(), image.size()}) << std::dec
+              << std::setfill(' ') << std::endl;
 
   std::cout << "write to file : " << filename << std::endl;
-  if (!stbi_write_png(filename.c_str(), yk::constants::image_width,
-                      yk::constants::image_height, 3, image.data(),
-                      3 * yk::constants::image_width)) {
+  if (!yk::write_image(filename, image, config, samples_per_pixel, output)) {
     std::cout << "error" << std::endl;
     std::exit(EXIT_FAILURE);
   }
   std::cout << "success" << std::endl;
+  write_trace();
 }
@@ -0,0 +1,115 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_BAND_PIPELINE_H
+#define YK_RAYTRACING_BAND_PIPELINE_H
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+
+#include "color.hpp"
+#include "framebuffer.hpp"
+
+namespace yk {
+
+// Hands finished row bands from the render loop to a consumer thread. Two
+// band buffers are cycled, so rendering band n + 1 overlaps consuming band n
+// and memory stays at two bands whatever the image height. Bands reach the
+// consumer in submission order.
+class band_pipeline {
+ public:
+  using consumer_type =
+      std::function<void(std::uint32_t first_row, std::span<const color3b>)>;
+
+  band_pipeline(std::uint32_t width, std::uint32_t band_height,
+                consumer_type consumer,
+                framebuffer_backing backing = framebuffer_backing::heap)
+      : band_height_(band_height),
+        slots_{slot{framebuffer(width, band_height, backing)},
+               slot{framebuffer(width, band_height, backing)}},
+        consumer_(std::move(consumer)),
+        thread_([this] { consume(); }) {}
+
+  band_pipeline(const band_pipeline&) = delete;
+  band_pipeline& operator=(const band_pipeline&) = delete;
+
+  ~band_pipeline() { finish(); }
+
+  std::uint32_t band_height() const { return band_height_; }
+
+  // blocks until the consumer has released the next buffer
+  framebuffer& acquire() {
+    std::unique_lock lock(mutex_);
+    slot& s = slots_[produced_ % slots_.size()];
+    cv_.wait(lock, [&] { return !s.ready; });
+    return s.band;
+  }
+
+  // hands the buffer returned by the last acquire() over to the consumer
+  void submit(std::uint32_t first_row, std::uint32_t rows) {
+    {
+      std::lock_guard lock(mutex_);
+      slot& s = slots_[produced_++ % slots_.size()];
+      s.first_row = first_row;
+      s.rows = rows;
+      s.ready = true;
+    }
+    cv_.notify_all();
+  }
+
+  // waits until every submitted band has been consumed
+  void finish() {
+    {
+      std::lock_guard lock(mutex_);
+      done_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+ private:
+  struct slot {
+    framebuffer band;
+    std::uint32_t first_row = 0;
+    std::uint32_t rows = 0;
+    bool ready = false;
+  };
+
+  void consume() {
+    for (std::size_t consumed = 0;; ++consumed) {
+      slot& s = slots_[consumed % slots_.size()];
+      {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [&] {
+          return s.ready || (done_ && consumed == produced_);
+        });
+        if (!s.ready) return;
+      }
+      consumer_(s.first_row, s.band.rows(0, s.rows));
+      {
+        std::lock_guard lock(mutex_);
+        s.ready = false;
+      }
+      cv_.notify_all();
+    }
+  }
+
+  std::uint32_t band_height_;
+  std::array<slot, 2> slots_;
+  consumer_type consumer_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::size_t produced_ = 0;
+  bool done_ = false;
+  std::thread thread_;
+};
+
+}  // namespace yk
+
+#endif  // !YK_RAYTRACING_BAND_PIPELINE_H
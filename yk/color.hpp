@@ -117,6 +117,7 @@ constexpr auto operator/(T scalar, color3<U> color) {
 }
 
 using color3b = color3<uint8_t>;
+using color3f = color3<float>;
 using color3d = color3<double>;
 
 }  // namespace yk
@@ -3,6 +3,8 @@
 #ifndef YK_RAYTRACING_CONFIG_H
 #define YK_RAYTRACING_CONFIG_H
 
+#include <cstdint>
+
 #ifndef YK_ENABLE_CONSTEXPR
 #define YK_ENABLE_CONSTEXPR 0
 #endif  // !YK_ENABLE_CONSTEXPR
@@ -26,7 +28,7 @@
 #endif  // YK_ENABLE_CONSTEXPR
 
 namespace yk {
-  std::uint32_t verbose = 0;
+  inline std::uint32_t verbose = 0;
 }
 
 #endif  // !YK_RAYTRACING_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_CONSTEXPR_BANDS_H
+#define YK_RAYTRACING_CONSTEXPR_BANDS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+#include "color.hpp"
+#include "config.hpp"
+#include "render.hpp"
+
+// The compile-time image split into YK_CONSTEXPR_BANDS row bands. Every band
+// is evaluated in its own translation unit (constexpr_bands_N/band_I.cpp,
+// generated by the Makefile), so the bands compile in parallel and each stays
+// within the constexpr ops limit; the program links them and stitches the
+// rows together at startup.
+
+#if !YK_ENABLE_CONSTEXPR
+#error "constexpr bands need YK_ENABLE_CONSTEXPR"
+#endif  // !YK_ENABLE_CONSTEXPR
+
+#ifndef YK_CONSTEXPR_BANDS
+#error "YK_CONSTEXPR_BANDS must give the number of bands"
+#endif  // !YK_CONSTEXPR_BANDS
+
+// every translation unit has to draw the same samples
+#ifndef YK_SEED
+#error "constexpr bands need an explicit YK_SEED"
+#endif  // !YK_SEED
+
+namespace yk::constexpr_bands {
+
+inline constexpr std::uint32_t count = YK_CONSTEXPR_BANDS;
+
+static_assert(count > 0 && count <= constants::image_height);
+
+constexpr std::uint32_t first_row(std::uint32_t band) {
+  return band * constants::image_height / count;
+}
+
+template <std::uint32_t Band>
+using pixels_t = std::array<color3b, (first_row(Band + 1) - first_row(Band)) *
+                                         constants::image_width>;
+
+// the rows of one band, in the same order render() produces them
+template <std::uint32_t Band, concepts::arithmetic T = double>
+constexpr pixels_t<Band> render_band(const render_config& config = {}) {
+  const auto r = make_renderer<T>(config);
+  pixels_t<Band> pixels = {};
+  for_each_pixel(config, first_row(Band), first_row(Band + 1),
+                 [&](std::uint32_t y, std::uint32_t x) {
+                   const auto i = (y - first_row(Band)) * config.image_width + x;
+                   pixels[i] = to_color3b(
+                       r.sample_pixel(y, x, 0, config.samples_per_pixel),
+                       config.samples_per_pixel);
+                 });
+  return pixels;
+}
+
+// defined by the band's translation unit
+template <std::uint32_t Band>
+std::span<const color3b> pixels();
+
+template <std::uint32_t... Bands>
+image_t stitch(std::integer_sequence<std::uint32_t, Bands...>) {
+  image_t image = {};
+  (std::ranges::copy(pixels<Bands>(), image.begin() + first_row(Bands) *
+                                                          constants::image_width),
+   ...);
+  return image;
+}
+
+inline image_t stitch() {
+  return stitch(std::make_integer_sequence<std::uint32_t, count>());
+}
+
+}  // namespace yk::constexpr_bands
+
+#endif  // !YK_RAYTRACING_CONSTEXPR_BANDS_H
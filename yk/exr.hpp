@@ -0,0 +1,198 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_EXR_H
+#define YK_RAYTRACING_EXR_H
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "color.hpp"
+
+// A writer for the single-part scanline subset of OpenEXR: R, G and B
+// channels of either half or float, uncompressed or ZIP (16-line blocks).
+
+namespace yk::exr {
+
+enum class pixel_type : std::uint32_t { half = 1, single = 2 };
+
+enum class compression : std::uint8_t { none = 0, zip = 3 };
+
+namespace detail {
+
+// IEEE binary16, round to nearest even; overflow goes to infinity
+constexpr std::uint16_t to_half(float value) {
+  const auto bits = std::bit_cast<std::uint32_t>(value);
+  const std::uint16_t sign = (bits >> 16) & 0x8000;
+  const std::uint32_t abs = bits & 0x7fffffff;
+
+  if (abs >= 0x7f800000)  // inf or nan
+    return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+  if (abs >= 0x477ff000)  // rounds to beyond the largest half
+    return sign | 0x7c00;
+  if (abs < 0x38800000) {  // subnormal half or zero
+    if (abs < 0x33000000) return sign;
+    const std::uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+    const int shift = 126 - static_cast<int>(abs >> 23);
+    const std::uint32_t half = mantissa >> shift;
+    const std::uint32_t rest = mantissa & ((1u << shift) - 1);
+    const std::uint32_t midpoint = 1u << (shift - 1);
+    const bool round_up = rest > midpoint || (rest == midpoint && (half & 1));
+    return sign | (half + round_up);
+  }
+  const std::uint32_t rounded =
+      abs - 0x38000000 + 0xfff + ((abs >> 13) & 1);  // rebias and round
+  return sign | static_cast<std::uint16_t>(rounded >> 13);
+}
+
+class byte_writer {
+ public:
+  explicit byte_writer(std::vector<std::uint8_t>& out) : out_(out) {}
+
+  template <class T>
+  byte_writer& le(T value) {
+    std::uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big)
+      std::reverse(bytes, bytes + sizeof(T));
+    out_.insert(out_.end(), bytes, bytes + sizeof(T));
+    return *this;
+  }
+
+  byte_writer& str(std::string_view s) {
+    out_.insert(out_.end(), s.begin(), s.end());
+    out_.push_back(0);
+    return *this;
+  }
+
+  byte_writer& attribute(std::string_view name, std::string_view type,
+                         std::uint32_t size) {
+    return str(name).str(type).le(size);
+  }
+
+ private:
+  std::vector<std::uint8_t>& out_;
+};
+
+// OpenEXR's ZIP preprocessing: split even and odd bytes, then delta-encode
+inline std::vector<std::uint8_t> zip_predict(
+    std::span<const std::uint8_t> raw) {
+  std::vector<std::uint8_t> out(raw.size());
+  const std::size_t half = (raw.size() + 1) / 2;
+  for (std::size_t i = 0; i < raw.size(); ++i)
+    out[(i & 1) ? half + i / 2 : i / 2] = raw[i];
+  for (std::size_t i = out.size() - 1; i > 0; --i)
+    out[i] = static_cast<std::uint8_t>(out[i] - out[i - 1] + 128);
+  return out;
+}
+
+}  // namespace detail
+
+inline constexpr std::size_t lines_per_block(compression c) {
+  return c == compression::zip ? 16 : 1;
+}
+
+// Writes linear radiance, each pixel multiplied by `scale` (e.g. 1 / spp for
+// sample sums), top row first.
+inline bool write(const std::string& filename, std::uint32_t width,
+                  std::uint32_t height, std::span<const color3f> radiance,
+                  float scale = 1.0f, pixel_type type = pixel_type::half,
+                  compression comp = compression::zip) {
+  if (width == 0 || height == 0) return false;
+
+  std::vector<std::uint8_t> header;
+  detail::byte_writer w(header);
+  w.le(std::uint32_t(20000630)).le(std::uint32_t(2));
+
+  // channels are stored in alphabetical order
+  constexpr std::string_view channels[] = {"B", "G", "R"};
+  w.attribute("channels", "chlist", 3 * (2 + 16) + 1);
+  for (auto name : channels)
+    w.str(name)
+        .le(static_cast<std::uint32_t>(type))
+        .le(std::uint32_t(0))  // pLinear + reserved
+        .le(std::int32_t(1))
+        .le(std::int32_t(1));
+  w.le(std::uint8_t(0));
+  w.attribute("compression", "compression", 1)
+      .le(static_cast<std::uint8_t>(comp));
+  for (auto window : {"dataWindow", "displayWindow"})
+    w.attribute(window, "box2i", 16)
+        .le(std::int32_t(0))
+        .le(std::int32_t(0))
+        .le(std::int32_t(width - 1))
+        .le(std::int32_t(height - 1));
+  w.attribute("lineOrder", "lineOrder", 1).le(std::uint8_t(0));
+  w.attribute("pixelAspectRatio", "float", 4).le(1.0f);
+  w.attribute("screenWindowCenter", "v2f", 8).le(0.0f).le(0.0f);
+  w.attribute("screenWindowWidth", "float", 4).le(1.0f);
+  w.le(std::uint8_t(0));
+
+  const std::size_t block_lines = lines_per_block(comp);
+  const std::size_t blocks = (height + block_lines - 1) / block_lines;
+  const std::size_t table_size = blocks * sizeof(std::uint64_t);
+  std::vector<std::uint8_t> offsets;
+
+  std::vector<std::uint8_t> body;
+  std::vector<std::uint8_t> raw;
+  std::vector<std::uint8_t> compressed;
+  for (std::size_t block = 0; block < blocks; ++block) {
+    const std::size_t first = block * block_lines;
+    const std::size_t last =
+        std::min<std::size_t>(first + block_lines, height);
+
+    raw.clear();
+    detail::byte_writer r(raw);
+    for (std::size_t y = first; y < last; ++y) {
+      const auto* row = radiance.data() + y * width;
+      for (auto channel : {&color3f::b, &color3f::g, &color3f::r})
+        for (std::uint32_t x = 0; x < width; ++x) {
+          const float value = row[x].*channel * scale;
+          if (type == pixel_type::half)
+            r.le(detail::to_half(value));
+          else
+            r.le(value);
+        }
+    }
+
+    std::span<const std::uint8_t> data = raw;
+    if (comp == compression::zip) {
+      const auto predicted = detail::zip_predict(raw);
+      uLongf size = compressBound(predicted.size());
+      compressed.resize(size);
+      if (compress(compressed.data(), &size, predicted.data(),
+                   predicted.size()) != Z_OK)
+        return false;
+      // incompressible blocks are stored as they are
+      if (size < raw.size()) data = {compressed.data(), size};
+    }
+
+    detail::byte_writer(offsets).le(
+        std::uint64_t(header.size() + table_size + body.size()));
+    detail::byte_writer(body)
+        .le(std::int32_t(first))
+        .le(std::uint32_t(data.size()));
+    body.insert(body.end(), data.begin(), data.end());
+  }
+
+  std::FILE* file = std::fopen(filename.c_str(), "wb");
+  if (!file) return false;
+  bool ok = true;
+  for (const auto* part : {&header, &offsets, &body})
+    ok = ok &&
+         std::fwrite(part->data(), 1, part->size(), file) == part->size();
+  return std::fclose(file) == 0 && ok;
+}
+
+}  // namespace yk::exr
+
+#endif  // !YK_RAYTRACING_EXR_H
@@ -0,0 +1,202 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_FRAMEBUFFER_H
+#define YK_RAYTRACING_FRAMEBUFFER_H
+
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "color.hpp"
+
+namespace yk {
+
+enum class framebuffer_backing {
+  heap,        // aligned operator new
+  huge_pages,  // anonymous mmap advised for transparent huge pages
+};
+
+// a rectangular window into a row-major pixel buffer; does not own the pixels
+template <class Pixel>
+struct tile_view {
+  Pixel* origin;
+  std::uint32_t width;
+  std::uint32_t height;
+  std::size_t stride;  // in pixels
+
+  std::span<Pixel> row(std::uint32_t y) const {
+    return {origin + y * stride, width};
+  }
+
+  Pixel& operator()(std::uint32_t x, std::uint32_t y) const {
+    return origin[y * stride + x];
+  }
+};
+
+namespace detail {
+
+// owning, uninitialized, over-aligned storage for trivial element types
+template <class T>
+class aligned_buffer {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+ public:
+  static constexpr std::size_t alignment = 64;  // cache line
+  static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+  aligned_buffer() = default;
+
+  aligned_buffer(std::size_t size, framebuffer_backing backing)
+      : size_(size), bytes_(size * sizeof(T)) {
+    if (bytes_ == 0) return;
+    if (backing == framebuffer_backing::huge_pages) {
+      // round up so the tail is huge-page backed as well
+      bytes_ = (bytes_ + huge_page_size - 1) / huge_page_size * huge_page_size;
+      void* p = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+        ::madvise(p, bytes_, MADV_HUGEPAGE);
+#endif  // MADV_HUGEPAGE
+        data_ = static_cast<T*>(p);
+        mapped_ = true;
+        return;
+      }
+      // fall back to the heap when the mapping is refused
+      bytes_ = size * sizeof(T);
+    }
+    data_ = static_cast<T*>(
+        ::operator new(bytes_, std::align_val_t(alignment)));
+  }
+
+  aligned_buffer(aligned_buffer&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)),
+        bytes_(std::exchange(other.bytes_, 0)),
+        mapped_(std::exchange(other.mapped_, false)) {}
+
+  aligned_buffer& operator=(aligned_buffer&& other) noexcept {
+    if (this != &other) {
+      release();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      bytes_ = std::exchange(other.bytes_, 0);
+      mapped_ = std::exchange(other.mapped_, false);
+    }
+    return *this;
+  }
+
+  ~aligned_buffer() { release(); }
+
+  T* data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  void release() {
+    if (!data_) return;
+    if (mapped_)
+      ::munmap(data_, bytes_);
+    else
+      ::operator delete(data_, std::align_val_t(alignment));
+    data_ = nullptr;
+  }
+
+  T* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t bytes_ = 0;
+  bool mapped_ = false;
+};
+
+}  // namespace detail
+
+// Runtime-sized image storage: the 8-bit output next to the float
+// accumulation it is resolved from. Both planes are row-major with no
+// padding, so a band of rows is a contiguous span.
+class framebuffer {
+ public:
+  using pixel_type = color3b;
+  using accumulation_type = color3f;
+
+  framebuffer() = default;
+
+  framebuffer(std::uint32_t width, std::uint32_t height,
+              framebuffer_backing backing = framebuffer_backing::heap)
+      : width_(width),
+        height_(height),
+        pixels_(std::size_t(width) * height, backing),
+        accumulation_(std::size_t(width) * height, backing) {}
+
+  std::uint32_t width() const { return width_; }
+  std::uint32_t height() const { return height_; }
+  std::size_t size() const { return pixels_.size(); }
+
+  pixel_type* data() { return pixels_.data(); }
+  const pixel_type* data() const { return pixels_.data(); }
+
+  pixel_type& operator[](std::size_t i) { return pixels_.data()[i]; }
+  const pixel_type& operator[](std::size_t i) const {
+    return pixels_.data()[i];
+  }
+
+  pixel_type* begin() { return data(); }
+  pixel_type* end() { return data() + size(); }
+  const pixel_type* begin() const { return data(); }
+  const pixel_type* end() const { return data() + size(); }
+
+  std::span<pixel_type> pixels() { return {pixels_.data(), size()}; }
+  std::span<const pixel_type> pixels() const {
+    return {pixels_.data(), size()};
+  }
+
+  std::span<accumulation_type> accumulation() {
+    return {accumulation_.data(), size()};
+  }
+  std::span<const accumulation_type> accumulation() const {
+    return {accumulation_.data(), size()};
+  }
+
+  // rows [first, last) as one contiguous span
+  std::span<pixel_type> rows(std::uint32_t first, std::uint32_t last) {
+    return pixels().subspan(std::size_t(first) * width_,
+                            std::size_t(last - first) * width_);
+  }
+  std::span<const pixel_type> rows(std::uint32_t first,
+                                   std::uint32_t last) const {
+    return pixels().subspan(std::size_t(first) * width_,
+                            std::size_t(last - first) * width_);
+  }
+
+  std::span<pixel_type> row(std::uint32_t y) { return rows(y, y + 1); }
+  std::span<const pixel_type> row(std::uint32_t y) const {
+    return rows(y, y + 1);
+  }
+
+  tile_view<pixel_type> tile(std::uint32_t x, std::uint32_t y,
+                             std::uint32_t width, std::uint32_t height) {
+    return {pixels_.data() + std::size_t(y) * width_ + x, width, height,
+            width_};
+  }
+
+  tile_view<accumulation_type> accumulation_tile(std::uint32_t x,
+                                                 std::uint32_t y,
+                                                 std::uint32_t width,
+                                                 std::uint32_t height) {
+    return {accumulation_.data() + std::size_t(y) * width_ + x, width, height,
+            width_};
+  }
+
+ private:
+  std::uint32_t width_ = 0;
+  std::uint32_t height_ = 0;
+  detail::aligned_buffer<pixel_type> pixels_;
+  detail::aligned_buffer<accumulation_type> accumulation_;
+};
+
+}  // namespace yk
+
+#endif  // !YK_RAYTRACING_FRAMEBUFFER_H
@@ -0,0 +1,40 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_HASH_H
+#define YK_RAYTRACING_HASH_H
+
+#include <cstdint>
+#include <span>
+
+#include "color.hpp"
+
+namespace yk::hash {
+
+// the splitmix64 finalizer : every input bit affects every output bit
+constexpr std::uint64_t mix(std::uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// The RNG seed of one sample. It depends only on its arguments, so any
+// schedule of pixels and samples over threads draws the same numbers.
+constexpr std::uint64_t sample_seed(std::uint64_t frame_seed,
+                                    std::uint64_t pixel, std::uint64_t sample) {
+  return mix(mix(frame_seed ^ mix(pixel)) + sample);
+}
+
+inline constexpr std::uint64_t fnv_offset = 0xcbf29ce484222325ULL;
+
+// 64-bit FNV-1a, continuing from `h`
+constexpr std::uint64_t fnv1a(std::span<const color3b> pixels,
+                              std::uint64_t h = fnv_offset) {
+  constexpr std::uint64_t prime = 0x100000001b3ULL;
+  for (const auto& p : pixels)
+    for (std::uint8_t byte : {p.r, p.g, p.b}) h = (h ^ byte) * prime;
+  return h;
+}
+
+}  // namespace yk::hash
+
+#endif  // !YK_RAYTRACING_HASH_H
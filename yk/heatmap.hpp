@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_HEATMAP_H
+#define YK_RAYTRACING_HEATMAP_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "color.hpp"
+#include "stats.hpp"
+
+// Per-pixel cost capture and its false-color rendering. The cost of a pixel
+// task is measured on the thread that runs it, so the parallel build needs no
+// synchronization beyond writing distinct elements.
+
+namespace yk::heatmap {
+
+enum class metric {
+  cycles,  // time stamp counter, or nanoseconds where there is none
+  rays,    // primary and bounce rays traced
+  tests,   // ray-sphere intersection tests
+};
+
+constexpr std::optional<metric> parse_metric(std::string_view name) {
+  if (name == "cycles") return metric::cycles;
+  if (name == "rays") return metric::rays;
+  if (name == "tests") return metric::tests;
+  return std::nullopt;
+}
+
+namespace detail {
+
+inline std::uint64_t read(metric m) {
+  switch (m) {
+    case metric::cycles:
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    case metric::rays:
+      return stats::detail::local().rays();
+    case metric::tests:
+      return stats::detail::local()[stats::counter::sphere_tests];
+  }
+  return 0;
+}
+
+// Polynomial fit of the Turbo colormap (Mikhailov 2019), t in [0, 1]
+inline color3b turbo(float t) {
+  const float t2 = t * t, t3 = t2 * t, t4 = t3 * t, t5 = t4 * t;
+  const auto channel = [](float v) {
+    return static_cast<std::uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+  };
+  return {
+      .r = channel(0.13572138f + 4.61539260f * t - 42.66032258f * t2 +
+                   132.13108234f * t3 - 152.94239396f * t4 +
+                   59.28637943f * t5),
+      .g = channel(0.09140261f + 2.19418839f * t + 4.84296658f * t2 -
+                   14.18503333f * t3 + 4.27729857f * t4 + 2.82956604f * t5),
+      .b = channel(0.10667330f + 12.64194608f * t - 60.58204836f * t2 +
+                   110.36276771f * t3 - 89.90310912f * t4 +
+                   27.34824973f * t5),
+  };
+}
+
+}  // namespace detail
+
+// runs `task` and returns what it cost the calling thread
+template <class F>
+float measure(metric m, F&& task) {
+  const std::uint64_t begin = detail::read(m);
+  task();
+  return static_cast<float>(detail::read(m) - begin);
+}
+
+// The 99th percentile maps to the top of the scale, so a handful of pixels
+// hit by a page fault or preemption do not wash out the rest of the image.
+inline float normalizer(std::span<const float> cost) {
+  if (cost.empty()) return 1.0f;
+  std::vector<float> sorted(cost.begin(), cost.end());
+  const auto nth = sorted.begin() + (sorted.size() - 1) * 99 / 100;
+  std::nth_element(sorted.begin(), nth, sorted.end());
+  return *nth > 0 ? *nth : 1.0f;
+}
+
+inline std::vector<color3b> false_color(std::span<const float> cost) {
+  const float scale = 1.0f / normalizer(cost);
+  std::vector<color3b> pixels(cost.size());
+  std::ranges::transform(cost, pixels.begin(), [&](float c) {
+    return detail::turbo(std::min(c * scale, 1.0f));
+  });
+  return pixels;
+}
+
+}  // namespace yk::heatmap
+
+#endif  // !YK_RAYTRACING_HEATMAP_H
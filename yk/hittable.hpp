@@ -3,12 +3,18 @@
 #ifndef YK_RAYTRACING_HITTABLE_H
 #define YK_RAYTRACING_HITTABLE_H
 
+#include <array>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <type_traits>
 #include <optional>
+#include <span>
 
 #include "concepts.hpp"
 #include "ray.hpp"
+#include "ray_packet.hpp"
 #include "vec3.hpp"
 
 namespace yk {
@@ -18,7 +24,7 @@ struct hit_record {
   pos3<T, world_tag> p;
   vec3<T> normal;
   T t;
-  size_t id;
+  std::uint32_t id;
   bool front_face;
   constexpr void set_face_normal(const ray<T>& r,
                                  const vec3<T>& outward_normal) {
@@ -27,10 +33,71 @@ struct hit_record {
   }
 };
 
+// What traversal keeps of a hit : how far along the ray, and on which object.
+// The rest of its hit_record is computed once, for the closest hit only.
+template <concepts::arithmetic T>
+struct hit_candidate {
+  T t;
+  std::uint32_t id;
+};
+
+// the t of a hit_candidate that holds no hit
+template <concepts::arithmetic T>
+inline constexpr T no_hit = std::numeric_limits<T>::infinity();
+
 template <concepts::arithmetic T, class Derived>
 struct hittable_interface {
+  // Tests for a hit within [t_min, closest.t]; on one, stores it in
+  // `closest` and returns true.
+  constexpr bool intersect(const ray<T>& r, T t_min, hit_candidate<T>& closest) const {
+    return static_cast<const Derived*>(this)->intersect_impl(r, t_min, closest);
+  }
+
+  // the full record of a hit that intersect() found
+  constexpr hit_record<T> finalize(const ray<T>& r, const hit_candidate<T>& hit) const {
+    return static_cast<const Derived*>(this)->finalize_impl(r, hit);
+  }
+
+  // The buffer form of intersect(), for acceleration structures and SIMD
+  // kernels : tests rays[i] within [t_min, hits[i].t] for every i, and on a
+  // hit stores its t and first_id + its id in hits[i]. Misses leave hits[i]
+  // as it was, so hits that start at {no_hit<T>, 0} tell a miss by their t.
+  // Objects without a loop of their own (intersect_n_impl) are tested ray by
+  // ray through intersect().
+  constexpr void intersect(std::span<const ray<T>> rays, T t_min,
+                           std::span<hit_candidate<T>> hits,
+                           std::uint32_t first_id = 0) const {
+    const auto& self = *static_cast<const Derived*>(this);
+    if constexpr (requires { self.intersect_n_impl(rays, t_min, hits, first_id); }) {
+      self.intersect_n_impl(rays, t_min, hits, first_id);
+    } else {
+      for (std::size_t i = 0; i < rays.size(); ++i) {
+        if (intersect(rays[i], t_min, hits[i])) hits[i].id += first_id;
+      }
+    }
+  }
+
+  // The packet form of the buffer intersect(), for N coherent rays such as
+  // the primary rays of neighbouring pixels. Objects without a packet kernel
+  // (intersect_packet_impl) test the packet ray by ray.
+  template <std::size_t N>
+  constexpr void intersect(const ray_packet<T, N>& rays, T t_min,
+                           std::array<hit_candidate<T>, N>& hits,
+                           std::uint32_t first_id = 0) const {
+    const auto& self = *static_cast<const Derived*>(this);
+    if constexpr (requires { self.intersect_packet_impl(rays, t_min, hits, first_id); }) {
+      self.intersect_packet_impl(rays, t_min, hits, first_id);
+    } else {
+      for (std::size_t i = 0; i < N; ++i) {
+        if (intersect(rays[i], t_min, hits[i])) hits[i].id += first_id;
+      }
+    }
+  }
+
   constexpr std::optional<hit_record<T>> hit(const ray<T>& r, T t_min, T t_max) const {
-    return static_cast<const Derived*>(this)->hit_impl(r, t_min, t_max);
+    hit_candidate<T> closest = {t_max, 0};
+    if (!intersect(r, t_min, closest)) return std::nullopt;
+    return finalize(r, closest);
   }
 
   // returns optioanl of pair of { color3<U> attenuation, ray<T> scattered }
@@ -48,6 +115,15 @@ concept hittable =
 
 }  // namespace concepts
 
+// The number of ids a hittable hands out in hit_candidate::id : one for a
+// single object, `count` for an aggregate, whose ids are [0, count).
+template <class H>
+inline constexpr std::size_t object_count = 1;
+
+template <class H>
+  requires requires { H::count; }
+inline constexpr std::size_t object_count<H> = H::count;
+
 }  // namespace yk
 
 #endif  // !YK_RAYTRACING_HITTABLE_H
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_HITTABLE_ARRAY_H
+#define YK_RAYTRACING_HITTABLE_ARRAY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <utility>
+
+#include "color.hpp"
+#include "concepts.hpp"
+#include "hittable.hpp"
+#include "ray.hpp"
+#include "ray_packet.hpp"
+
+namespace yk {
+
+// N objects of one type, tested in a plain loop. A scene of many objects of
+// a few types compiles as a hittable_list of one hittable_array per type at
+// a cost independent of N, where a hittable_list of N objects instantiates a
+// tuple of N elements.
+template <concepts::arithmetic T, concepts::hittable<T> H, std::size_t N>
+struct hittable_array : public hittable_interface<T, hittable_array<T, H, N>> {
+  static constexpr std::size_t count = N * object_count<H>;
+
+  std::array<H, N> objects;
+
+  constexpr hittable_array(std::array<H, N> objects_)
+      : objects(std::move(objects_)) {}
+
+  constexpr bool intersect_impl(const ray<T>& r, T t_min,
+                                hit_candidate<T>& closest) const {
+    bool found = false;
+    for (std::size_t i = 0; i < N; ++i) {
+      if (objects[i].intersect(r, t_min, closest)) {
+        closest.id += i * object_count<H>;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  constexpr void intersect_n_impl(std::span<const ray<T>> rays, T t_min,
+                                  std::span<hit_candidate<T>> hits,
+                                  std::uint32_t first_id) const {
+    for (std::size_t i = 0; i < N; ++i)
+      objects[i].intersect(rays, t_min, hits, first_id + i * object_count<H>);
+  }
+
+  template <std::size_t M>
+  constexpr void intersect_packet_impl(const ray_packet<T, M>& rays, T t_min,
+                                       std::array<hit_candidate<T>, M>& hits,
+                                       std::uint32_t first_id) const {
+    for (std::size_t i = 0; i < N; ++i)
+      objects[i].intersect(rays, t_min, hits, first_id + i * object_count<H>);
+  }
+
+  constexpr hit_record<T> finalize_impl(const ray<T>& r,
+                                        const hit_candidate<T>& hit) const {
+    auto local = hit;
+    local.id %= object_count<H>;
+    auto rec = objects[hit.id / object_count<H>].finalize(r, local);
+    rec.id = hit.id;
+    return rec;
+  }
+
+  template <concepts::arithmetic U, std::uniform_random_bit_generator Gen>
+  constexpr std::optional<std::pair<color3<U>, ray<T>>> scatter_impl(
+      const ray<T>& r, const hit_record<T>& rec, Gen& gen) const {
+    auto local = rec;
+    local.id %= object_count<H>;
+    return objects[rec.id / object_count<H>].template scatter<U>(r, local,
+                                                                 gen);
+  }
+};
+
+}  // namespace yk
+
+#endif  // !YK_RAYTRACING_HITTABLE_ARRAY_H
@@ -2,21 +2,28 @@
 #ifndef YK_RAYTRACING_HITTABLE_LIST_H
 #define YK_RAYTRACING_HITTABLE_LIST_H
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <limits>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <tuple>
 #include <utility>
 
-#include "../thirdparty/harmony.hpp"
 #include "concepts.hpp"
 #include "hittable.hpp"
 #include "ray.hpp"
+#include "ray_packet.hpp"
 #include "raytracer.hpp"
 
 namespace yk {
 
 template <concepts::arithmetic T, concepts::hittable<T>... Hs>
 struct hittable_list : public hittable_interface<T, hittable_list<T, Hs...>> {
+  static constexpr std::size_t count = (object_count<Hs> + ... + 0);
+
   std::tuple<Hs...> objects = {};
 
   constexpr hittable_list() = default;
@@ -29,48 +36,121 @@ struct hittable_list : public hittable_interface<T, hittable_list<T, Hs...>> {
         std::move(objects), std::tuple(std::move(h), std::move(args)...)));
   }
 
-  constexpr std::optional<hit_record<T>> hit_impl(const ray<T>& r, T t_min,
-                                                  T t_max) const {
-    using namespace harmony::monadic_op;
-    auto closest_so_far = t_max;
-    return [&]<std::size_t... Is>(std::index_sequence<Is...>) {
-      auto op = [&](concepts::hittable<T> auto h, std::size_t index) {
-        return h.hit(r, t_min, closest_so_far) |
-               and_then([&](hit_record<T> rec) {
-                 closest_so_far = rec.t;
-                 rec.id = index;
-                 return std::optional(rec);
-               });
-      };
-      return (std::optional<hit_record<T>>{} | ... |
-              fold(
-                  [&](const hit_record<T>& rec) {
-                    return *(op(std::get<Is>(objects), Is) |
-                             or_else([&](std::nullopt_t) {
-                               return std::optional(rec);
-                             }));
-                  },
-                  [&](std::nullopt_t) -> std::optional<hit_record<T>> {
-                    return op(std::get<Is>(objects), Is);
-                  }));
-    }
-    (std::index_sequence_for<Hs...>());
+  // The objects are visited in order by one generic lambda, so only one
+  // closure per distinct object type is instantiated, not one per object.
+  // They are visited in place; a copy would cost as much as the object and
+  // its material for every ray. An object's ids follow those of the objects
+  // before it.
+  constexpr bool intersect_impl(const ray<T>& r, T t_min,
+                                hit_candidate<T>& closest) const {
+    bool found = false;
+    std::size_t first = 0;
+    const auto test = [&]<concepts::hittable<T> H>(const H& h) {
+      if (h.intersect(r, t_min, closest)) {
+        closest.id += first;
+        found = true;
+      }
+      first += object_count<H>;
+    };
+    std::apply([&](const auto&... hs) { (test(hs), ...); }, objects);
+    return found;
+  }
+
+  constexpr void intersect_n_impl(std::span<const ray<T>> rays, T t_min,
+                                  std::span<hit_candidate<T>> hits,
+                                  std::uint32_t first_id) const {
+    std::size_t first = first_id;
+    const auto test = [&]<concepts::hittable<T> H>(const H& h) {
+      h.intersect(rays, t_min, hits, first);
+      first += object_count<H>;
+    };
+    std::apply([&](const auto&... hs) { (test(hs), ...); }, objects);
+  }
+
+  template <std::size_t N>
+  constexpr void intersect_packet_impl(const ray_packet<T, N>& rays, T t_min,
+                                       std::array<hit_candidate<T>, N>& hits,
+                                       std::uint32_t first_id) const {
+    std::size_t first = first_id;
+    const auto test = [&]<concepts::hittable<T> H>(const H& h) {
+      h.intersect(rays, t_min, hits, first);
+      first += object_count<H>;
+    };
+    std::apply([&](const auto&... hs) { (test(hs), ...); }, objects);
+  }
+
+  // finalize and scatter make one indirect call through a table indexed by
+  // the id, whatever the number of objects
+  constexpr hit_record<T> finalize_impl(const ray<T>& r,
+                                        const hit_candidate<T>& hit) const {
+    return finalize_table[hit.id](*this, r, hit);
   }
 
   template <concepts::arithmetic U, std::uniform_random_bit_generator Gen>
   constexpr std::optional<std::pair<color3<U>, ray<T>>> scatter(
       const ray<T>& r, const hit_record<T>& rec, Gen& gen) const {
-    using namespace harmony::monadic_op;
-    return [&]<size_t... Is>(std::index_sequence<Is...>) {
-      return (std::optional<std::pair<color3<U>, ray<T>>>{} | ... |
-              or_else([&](std::nullopt_t) {
-                return rec.id == Is ? std::get<Is>(objects).template scatter<U>(
-                                          r, rec, gen)
-                                    : std::nullopt;
-              }));
-    }
-    (std::index_sequence_for<Hs...>());
+    return scatter_table<U, Gen>[rec.id](*this, r, rec, gen);
+  }
+
+ private:
+  // the first id of each object
+  static constexpr std::array<std::size_t, sizeof...(Hs)> first_id = [] {
+    std::array<std::size_t, sizeof...(Hs)> first = {};
+    std::size_t next = 0;
+    std::size_t i = 0;
+    ((first[i++] = next, next += object_count<Hs>), ...);
+    return first;
+  }();
+
+  // `functions` holds one function per object; each is repeated over the
+  // object's ids
+  template <class F>
+  static constexpr std::array<F, count> id_table(
+      const std::array<F, sizeof...(Hs)>& functions) {
+    std::array<F, count> table = {};
+    std::size_t i = 0;
+    ((std::fill_n(table.begin() + first_id[i], object_count<Hs>, functions[i]),
+      ++i),
+     ...);
+    return table;
+  }
+
+  template <std::size_t I>
+  static constexpr hit_record<T> finalize_at(const hittable_list& list,
+                                             const ray<T>& r,
+                                             const hit_candidate<T>& hit) {
+    auto local = hit;
+    local.id -= first_id[I];
+    auto rec = std::get<I>(list.objects).finalize(r, local);
+    rec.id = hit.id;
+    return rec;
   }
+
+  using finalize_function = hit_record<T> (*)(const hittable_list&,
+                                              const ray<T>&,
+                                              const hit_candidate<T>&);
+
+  static constexpr std::array<finalize_function, count> finalize_table =
+      []<std::size_t... Is>(std::index_sequence<Is...>) {
+        return id_table<finalize_function>({&finalize_at<Is>...});
+      }(std::index_sequence_for<Hs...>());
+
+  template <std::size_t I, concepts::arithmetic U,
+            std::uniform_random_bit_generator Gen>
+  static constexpr std::optional<std::pair<color3<U>, ray<T>>> scatter_at(
+      const hittable_list& list, const ray<T>& r, const hit_record<T>& rec,
+      Gen& gen) {
+    auto local = rec;
+    local.id -= first_id[I];
+    return std::get<I>(list.objects).template scatter<U>(r, local, gen);
+  }
+
+  template <concepts::arithmetic U, std::uniform_random_bit_generator Gen>
+  static constexpr auto scatter_table =
+      []<std::size_t... Is>(std::index_sequence<Is...>) {
+        return id_table<decltype(&scatter_at<0, U, Gen>)>(
+            {&scatter_at<Is, U, Gen>...});
+      }(std::index_sequence_for<Hs...>());
 };
 
 }  // namespace yk
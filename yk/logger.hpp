@@ -0,0 +1,168 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_LOGGER_H
+#define YK_RAYTRACING_LOGGER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "config.hpp"
+
+// Asynchronous diagnostics for the hot loop. Each thread formats into its own
+// single-producer ring buffer without taking locks; a background thread
+// drains every ring to stderr. A full ring drops the record instead of
+// stalling the renderer, and the drops are reported when the log is flushed.
+
+namespace yk::log {
+
+namespace detail {
+
+struct record {
+  std::uint32_t length;
+  char text[124];
+};
+
+struct ring {
+  static constexpr std::size_t capacity = 1024;  // a power of two
+
+  std::array<record, capacity> records;
+  std::atomic<std::size_t> head = 0;  // next slot the producer writes
+  std::atomic<std::size_t> tail = 0;  // next slot the consumer reads
+  std::atomic<std::uint64_t> dropped = 0;
+
+  record* try_reserve() {
+    const auto h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == capacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &records[h % capacity];
+  }
+
+  void commit() {
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+};
+
+class logger {
+ public:
+  static logger& instance() {
+    static logger l;
+    return l;
+  }
+
+  ~logger() {
+    stop_ = true;
+    if (thread_.joinable()) thread_.join();
+    flush();
+  }
+
+  ring& local_ring() {
+    thread_local std::shared_ptr<ring> r = [this] {
+      auto created = std::make_shared<ring>();
+      std::lock_guard lock(rings_mutex_);
+      rings_.push_back(created);
+      return created;
+    }();
+    return *r;
+  }
+
+  // drains synchronously until every ring is empty
+  void flush() {
+    while (drain()) {
+    }
+    std::lock_guard lock(drain_mutex_);
+    if (dropped_) {
+      std::fprintf(stderr, "(log : %llu records dropped)\n",
+                   static_cast<unsigned long long>(dropped_));
+      dropped_ = 0;
+    }
+    std::fflush(stderr);
+  }
+
+ private:
+  logger() : thread_([this] { run(); }) {}
+
+  void run() {
+    while (!stop_)
+      if (!drain()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // returns whether anything was written
+  bool drain() {
+    std::lock_guard drain_lock(drain_mutex_);
+    std::vector<std::shared_ptr<ring>> rings;
+    {
+      std::lock_guard lock(rings_mutex_);
+      rings = rings_;
+    }
+    bool any = false;
+    for (const auto& r : rings) {
+      const auto t = r->tail.load(std::memory_order_relaxed);
+      const auto h = r->head.load(std::memory_order_acquire);
+      for (auto i = t; i != h; ++i) {
+        const record& rec = r->records[i % ring::capacity];
+        std::fwrite(rec.text, 1, rec.length, stderr);
+      }
+      r->tail.store(h, std::memory_order_release);
+      dropped_ += r->dropped.exchange(0, std::memory_order_relaxed);
+      any = any || t != h;
+    }
+    // rings of exited threads are released once they are empty
+    {
+      std::lock_guard lock(rings_mutex_);
+      std::erase_if(rings_, [](const auto& r) {
+        return r.use_count() == 1 &&
+               r->tail.load(std::memory_order_relaxed) ==
+                   r->head.load(std::memory_order_acquire);
+      });
+    }
+    return any;
+  }
+
+  std::mutex rings_mutex_;
+  std::vector<std::shared_ptr<ring>> rings_;
+  std::mutex drain_mutex_;
+  std::uint64_t dropped_ = 0;
+  std::atomic<bool> stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace detail
+
+// levels follow --verbose-level : 1 pixels, 2 samples, 3 rays
+constexpr bool enabled(std::uint32_t level) {
+  return !std::is_constant_evaluated() && level <= verbose;
+}
+
+// printf-style; the line is truncated to one record
+template <class... Args>
+constexpr void write(std::uint32_t level, const char* format, Args... args) {
+  if (!enabled(level)) return;
+  auto& ring = detail::logger::instance().local_ring();
+  detail::record* rec = ring.try_reserve();
+  if (!rec) return;
+  const int n = std::snprintf(rec->text, sizeof(rec->text), format, args...);
+  rec->length = std::clamp<int>(n, 0, sizeof(rec->text) - 1);
+  ring.commit();
+}
+
+// blocks until everything logged so far has been written
+inline void flush() {
+  if (verbose) detail::logger::instance().flush();
+}
+
+}  // namespace yk::log
+
+#endif  // !YK_RAYTRACING_LOGGER_H
@@ -0,0 +1,123 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_MAPPED_OUTPUT_H
+#define YK_RAYTRACING_MAPPED_OUTPUT_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "color.hpp"
+
+namespace yk {
+
+enum class mapped_layout {
+  ppm,  // binary P6
+  pfm,  // float, bottom row first
+  raw,  // headerless packed 8-bit RGB
+};
+
+// An output file preallocated at its final size and mapped shared, so render
+// workers store converted pixels straight into the page cache and nothing is
+// serialized at the end. store() may be called concurrently for distinct
+// pixels.
+class mapped_output {
+ public:
+  mapped_output(const std::string& filename, mapped_layout layout,
+                std::uint32_t width, std::uint32_t height)
+      : layout_(layout), width_(width), height_(height) {
+    const std::string header = make_header();
+    const std::size_t pixel_size =
+        layout == mapped_layout::pfm ? sizeof(color3f) : sizeof(color3b);
+    header_size_ = header.size();
+    size_ = header_size_ + std::size_t(width) * height * pixel_size;
+
+    fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) return;
+    // reserve the blocks up front so a full disk fails here, not as SIGBUS
+    // in a worker; fall back to a sparse file where that is unsupported
+    if (::posix_fallocate(fd_, 0, size_) != 0 && ::ftruncate(fd_, size_) != 0)
+      return;
+    void* p =
+        ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) return;
+    data_ = static_cast<std::byte*>(p);
+    std::memcpy(data_, header.data(), header.size());
+  }
+
+  mapped_output(const mapped_output&) = delete;
+  mapped_output& operator=(const mapped_output&) = delete;
+
+  ~mapped_output() { close(false); }
+
+  bool good() const { return data_ != nullptr; }
+  mapped_layout layout() const { return layout_; }
+
+  void store(std::uint32_t x, std::uint32_t y, const color3b& pixel) {
+    static_assert(sizeof(color3b) == 3);
+    std::memcpy(data_ + header_size_ +
+                    (std::size_t(y) * width_ + x) * sizeof(color3b),
+                &pixel, sizeof(color3b));
+  }
+
+  void store(std::uint32_t x, std::uint32_t y, const color3f& radiance) {
+    static_assert(sizeof(color3f) == 3 * sizeof(float));
+    std::memcpy(data_ + header_size_ +
+                    (std::size_t(height_ - 1 - y) * width_ + x) *
+                        sizeof(color3f),
+                &radiance, sizeof(color3f));
+  }
+
+  // Unmaps and closes the file. With `fsync` the pages are written back and
+  // the file is flushed to stable storage first; otherwise write-back is left
+  // to the kernel.
+  bool close(bool fsync) {
+    bool ok = data_ != nullptr;
+    if (data_) {
+      if (fsync) ok = ::msync(data_, size_, MS_SYNC) == 0;
+      ok = ::munmap(data_, size_) == 0 && ok;
+      data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+      if (fsync) ok = ::fsync(fd_) == 0 && ok;
+      ok = ::close(fd_) == 0 && ok;
+      fd_ = -1;
+    }
+    return ok;
+  }
+
+ private:
+  std::string make_header() const {
+    const std::string size =
+        std::to_string(width_) + ' ' + std::to_string(height_) + '\n';
+    switch (layout_) {
+      case mapped_layout::ppm:
+        return "P6\n" + size + "255\n";
+      case mapped_layout::pfm:
+        return "PF\n" + size +
+               (std::endian::native == std::endian::little ? "-1.0\n"
+                                                           : "1.0\n");
+      case mapped_layout::raw:
+        break;
+    }
+    return {};
+  }
+
+  mapped_layout layout_;
+  std::uint32_t width_;
+  std::uint32_t height_;
+  std::size_t header_size_ = 0;
+  std::size_t size_ = 0;
+  int fd_ = -1;
+  std::byte* data_ = nullptr;
+};
+
+}  // namespace yk
+
+#endif  // !YK_RAYTRACING_MAPPED_OUTPUT_H
@@ -13,6 +13,7 @@
 #include "hittable.hpp"
 #include "random.hpp"
 #include "ray.hpp"
+#include "stats.hpp"
 #include "vec3.hpp"
 
 namespace yk {
@@ -71,6 +72,7 @@ struct metal {
     auto scattered = ray(rec.p, reflected);
     if (dot(scattered.direction, rec.normal) > 0)
       return std::make_pair(albedo, scattered);
+    stats::add(stats::counter::scatter_rejections);
     return std::nullopt;
   }
 };
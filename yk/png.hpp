@@ -0,0 +1,358 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_PNG_H
+#define YK_RAYTRACING_PNG_H
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "color.hpp"
+#include "trace.hpp"
+
+namespace yk::png {
+
+namespace detail {
+
+constexpr std::uint8_t paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  if (pb <= pc) return b;
+  return c;
+}
+
+constexpr void put_u32(std::uint8_t* p, std::uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+// runs f(0) ... f(count - 1) on `threads` threads, the caller included
+template <class F>
+void parallel_for(std::size_t count, unsigned threads, F f) {
+  std::atomic<std::size_t> next = 0;
+  const auto worker = [&] {
+    for (std::size_t i; (i = next++) < count;) f(i);
+  };
+  std::vector<std::jthread> pool;
+  for (unsigned t = 1; t < threads && t < count; ++t) pool.emplace_back(worker);
+  worker();
+}
+
+}  // namespace detail
+
+inline constexpr std::size_t bytes_per_pixel = sizeof(color3b);
+
+// zlib's fastest level already compresses renders tighter than
+// stb_image_write does, at a fraction of the time of the default level
+inline constexpr int default_level = Z_BEST_SPEED;
+
+// Filters one scanline into `out` (1 filter-type byte + the filtered bytes),
+// picking the filter with the smallest sum of absolute residuals as
+// stb_image_write does. `prev` is empty for the first row of the image.
+inline void filter_row(std::span<const std::uint8_t> prev,
+                       std::span<const std::uint8_t> cur,
+                       std::span<std::uint8_t> out) {
+  constexpr std::size_t n = bytes_per_pixel;
+  const std::size_t len = cur.size();
+  const std::uint8_t* c = cur.data();
+  const std::uint8_t* p = prev.empty() ? nullptr : prev.data();
+
+  // writes the residuals of one filter type and returns their cost
+  const auto apply = [&]<int type>(std::integral_constant<int, type>,
+                                   std::uint8_t* dst) {
+    long cost = 0;
+    for (std::size_t i = 0; i < len; ++i) {
+      const int left = i < n ? 0 : c[i - n];
+      const int up = p ? p[i] : 0;
+      const int up_left = p && i >= n ? p[i - n] : 0;
+      std::uint8_t r;
+      if constexpr (type == 0) r = c[i];
+      if constexpr (type == 1) r = c[i] - left;
+      if constexpr (type == 2) r = c[i] - up;
+      if constexpr (type == 3) r = c[i] - ((left + up) >> 1);
+      if constexpr (type == 4) r = c[i] - detail::paeth(left, up, up_left);
+      dst[i] = r;
+      cost += std::abs(static_cast<std::int8_t>(r));
+    }
+    return cost;
+  };
+
+  // try every filter in `out`, remembering the cheapest
+  std::uint8_t* dst = out.data() + 1;
+  int best_type = 0;
+  long best_cost = -1;
+  [&]<int... types>(std::integer_sequence<int, types...>) {
+    ((void)[&] {
+      const long cost = apply(std::integral_constant<int, types>{}, dst);
+      if (best_cost < 0 || cost < best_cost) {
+        best_cost = cost;
+        best_type = types;
+      }
+    }(), ...);
+  }(std::make_integer_sequence<int, 5>{});
+
+  out[0] = best_type;
+  if (best_type == 4) return;  // the last one tried is still in place
+  [&]<int... types>(std::integer_sequence<int, types...>) {
+    ((types == best_type
+          ? (void)apply(std::integral_constant<int, types>{}, dst)
+          : void()),
+     ...);
+  }(std::make_integer_sequence<int, 4>{});
+}
+
+// Appends a complete chunk (length, type, data, CRC) to `out`.
+inline void append_chunk(std::vector<std::uint8_t>& out, const char (&type)[5],
+                         std::span<const std::uint8_t> data) {
+  std::uint8_t length[4];
+  detail::put_u32(length, data.size());
+  out.insert(out.end(), length, length + 4);
+  const std::size_t type_begin = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  std::uint8_t crc[4];
+  detail::put_u32(crc, ::crc32(0, out.data() + type_begin,
+                               out.size() - type_begin));
+  out.insert(out.end(), crc, crc + 4);
+}
+
+// The 8-byte signature followed by the IHDR of an 8-bit RGB image.
+inline std::vector<std::uint8_t> header(std::uint32_t width,
+                                        std::uint32_t height) {
+  std::vector<std::uint8_t> out = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  std::array<std::uint8_t, 13> ihdr = {};
+  detail::put_u32(ihdr.data(), width);
+  detail::put_u32(ihdr.data() + 4, height);
+  ihdr[8] = 8;  // bit depth
+  ihdr[9] = 2;  // color type : truecolor
+  append_chunk(out, "IHDR", ihdr);
+  return out;
+}
+
+// Encodes a PNG incrementally: rows are filtered and deflated as they arrive
+// and compressed output is flushed to the file in IDAT chunks, so memory use
+// does not depend on the image height. Rows must be written top to bottom.
+class stream_writer {
+ public:
+  static constexpr std::size_t idat_size = std::size_t(1) << 16;
+
+  stream_writer(const std::string& filename, std::uint32_t width,
+                std::uint32_t height, int level = default_level)
+      : width_(width),
+        height_(height),
+        file_(std::fopen(filename.c_str(), "wb")),
+        prev_(width * bytes_per_pixel),
+        filtered_(1 + width * bytes_per_pixel),
+        idat_(idat_size) {
+    ok_ = file_ && deflateInit(&zs_, level) == Z_OK;
+    if (!ok_) return;
+    zs_.next_out = idat_.data();
+    zs_.avail_out = idat_.size();
+    put(header(width, height));
+  }
+
+  stream_writer(const stream_writer&) = delete;
+  stream_writer& operator=(const stream_writer&) = delete;
+
+  ~stream_writer() {
+    if (file_) {
+      deflateEnd(&zs_);
+      std::fclose(file_);
+    }
+  }
+
+  bool good() const { return ok_; }
+
+  // `rows` holds whole scanlines
+  bool write_rows(std::span<const color3b> rows) {
+    const std::size_t row_bytes = width_ * bytes_per_pixel;
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(rows.data());
+    for (std::size_t offset = 0; ok_ && offset < rows.size_bytes();
+         offset += row_bytes) {
+      const std::span<const std::uint8_t> cur(bytes + offset, row_bytes);
+      filter_row(written_rows_ ? std::span<const std::uint8_t>(prev_)
+                               : std::span<const std::uint8_t>(),
+                 cur, filtered_);
+      std::ranges::copy(cur, prev_.begin());
+      ++written_rows_;
+      deflate_chunk(filtered_, Z_NO_FLUSH);
+    }
+    return ok_;
+  }
+
+  // Flushes the deflate stream and writes IEND. Fails if fewer rows than the
+  // image height were written.
+  bool finish() {
+    if (!ok_ || written_rows_ != height_) return ok_ = false;
+    deflate_chunk({}, Z_FINISH);
+    flush_idat();
+    std::vector<std::uint8_t> iend;
+    append_chunk(iend, "IEND", {});
+    put(iend);
+    ok_ = ok_ && std::fflush(file_) == 0;
+    return ok_;
+  }
+
+ private:
+  void put(std::span<const std::uint8_t> data) {
+    ok_ = ok_ && std::fwrite(data.data(), 1, data.size(), file_) == data.size();
+  }
+
+  void flush_idat() {
+    const std::size_t size = idat_.size() - zs_.avail_out;
+    if (size == 0) return;
+    std::vector<std::uint8_t> chunk;
+    chunk.reserve(size + 12);
+    append_chunk(chunk, "IDAT", {idat_.data(), size});
+    put(chunk);
+    zs_.next_out = idat_.data();
+    zs_.avail_out = idat_.size();
+  }
+
+  void deflate_chunk(std::span<std::uint8_t> in, int flush) {
+    zs_.next_in = in.data();
+    zs_.avail_in = in.size();
+    for (;;) {
+      const int ret = deflate(&zs_, flush);
+      if (ret == Z_STREAM_ERROR) {
+        ok_ = false;
+        return;
+      }
+      if (zs_.avail_out == 0) {
+        flush_idat();
+        continue;
+      }
+      if (zs_.avail_in == 0 && (flush != Z_FINISH || ret == Z_STREAM_END))
+        return;
+    }
+  }
+
+  std::uint32_t width_;
+  std::uint32_t height_;
+  std::uint32_t written_rows_ = 0;
+  std::FILE* file_;
+  z_stream zs_ = {};
+  bool ok_ = false;
+  std::vector<std::uint8_t> prev_;
+  std::vector<std::uint8_t> filtered_;
+  std::vector<std::uint8_t> idat_;
+};
+
+// Encodes a whole image with the row groups deflated concurrently, pigz
+// style: every group is an independent raw deflate stream primed with the
+// last 32 KiB of the preceding group and ended with a sync flush, so the
+// pieces concatenate into one valid zlib stream. `threads` == 0 uses every
+// hardware thread.
+inline bool write_parallel(const std::string& filename, std::uint32_t width,
+                           std::uint32_t height,
+                           std::span<const color3b> pixels,
+                           unsigned threads = 0,
+                           int level = default_level) {
+  constexpr std::size_t window_size = std::size_t(1) << 15;
+  constexpr std::size_t group_target = std::size_t(1) << 17;
+  constexpr std::size_t idat_size = std::size_t(1) << 20;
+
+  if (width == 0 || height == 0) return false;
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+  const std::size_t row_bytes = std::size_t(width) * bytes_per_pixel;
+  const std::size_t line_bytes = row_bytes + 1;
+  const std::size_t rows_per_group =
+      std::max<std::size_t>(1, group_target / line_bytes);
+  const std::size_t groups = (height + rows_per_group - 1) / rows_per_group;
+  const auto* bytes = reinterpret_cast<const std::uint8_t*>(pixels.data());
+
+  // filtering only looks at the raw previous row, so every row is independent
+  std::vector<std::uint8_t> filtered(line_bytes * height);
+  detail::parallel_for(groups, threads, [&](std::size_t g) {
+    const trace::scope scope("png filter", g);
+    const std::size_t last = std::min<std::size_t>((g + 1) * rows_per_group,
+                                                   height);
+    for (std::size_t y = g * rows_per_group; y < last; ++y)
+      filter_row(y ? std::span(bytes + (y - 1) * row_bytes, row_bytes)
+                   : std::span<const std::uint8_t>(),
+                 std::span(bytes + y * row_bytes, row_bytes),
+                 std::span(filtered.data() + y * line_bytes, line_bytes));
+  });
+
+  struct group_result {
+    std::vector<std::uint8_t> deflated;
+    uLong adler;
+    std::size_t length;
+    bool ok;
+  };
+  std::vector<group_result> results(groups);
+  detail::parallel_for(groups, threads, [&](std::size_t g) {
+    const trace::scope scope("png deflate", g);
+    const std::size_t begin = g * rows_per_group * line_bytes;
+    const std::size_t end =
+        std::min<std::size_t>((g + 1) * rows_per_group, height) * line_bytes;
+    auto& result = results[g];
+    result.length = end - begin;
+    result.adler = ::adler32(1, filtered.data() + begin, end - begin);
+
+    z_stream zs = {};
+    result.ok = deflateInit2(&zs, level, Z_DEFLATED, -15, 8,
+                             Z_DEFAULT_STRATEGY) == Z_OK;
+    if (!result.ok) return;
+    if (g != 0) {
+      const std::size_t dict = std::min(begin, window_size);
+      deflateSetDictionary(&zs, filtered.data() + begin - dict, dict);
+    }
+    result.deflated.resize(deflateBound(&zs, end - begin) + 16);
+    zs.next_in = filtered.data() + begin;
+    zs.avail_in = end - begin;
+    zs.next_out = result.deflated.data();
+    zs.avail_out = result.deflated.size();
+    const bool last = g + 1 == groups;
+    const int ret = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+    result.ok = last ? ret == Z_STREAM_END : ret == Z_OK && zs.avail_in == 0;
+    result.deflated.resize(result.deflated.size() - zs.avail_out);
+    deflateEnd(&zs);
+  });
+
+  // zlib header for the default window, then the pieces, then the checksum
+  std::vector<std::uint8_t> idat = {0x78, 0x9c};
+  uLong adler = ::adler32(0, nullptr, 0);
+  for (const auto& result : results) {
+    if (!result.ok) return false;
+    adler = ::adler32_combine(adler, result.adler, result.length);
+    idat.insert(idat.end(), result.deflated.begin(), result.deflated.end());
+  }
+  std::uint8_t checksum[4];
+  detail::put_u32(checksum, adler);
+  idat.insert(idat.end(), checksum, checksum + 4);
+
+  std::vector<std::uint8_t> out = header(width, height);
+  for (std::size_t offset = 0; offset < idat.size(); offset += idat_size) {
+    append_chunk(out, "IDAT",
+                 std::span(idat).subspan(
+                     offset, std::min(idat_size, idat.size() - offset)));
+  }
+  append_chunk(out, "IEND", {});
+
+  const trace::scope scope("png write");
+  std::FILE* file = std::fopen(filename.c_str(), "wb");
+  if (!file) return false;
+  const bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+}  // namespace yk::png
+
+#endif  // !YK_RAYTRACING_PNG_H
@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_PNM_H
+#define YK_RAYTRACING_PNM_H
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "color.hpp"
+
+namespace yk::pnm {
+
+namespace detail {
+
+// writev() until every byte is out, resuming after short writes
+inline bool write_all(int fd, std::span<iovec> iov) {
+  while (!iov.empty()) {
+    const ssize_t written = ::writev(fd, iov.data(), iov.size());
+    if (written < 0) return false;
+    auto remaining = static_cast<std::size_t>(written);
+    while (!iov.empty() && remaining >= iov.front().iov_len) {
+      remaining -= iov.front().iov_len;
+      iov = iov.subspan(1);
+    }
+    if (!iov.empty()) {
+      auto& front = iov.front();
+      front.iov_base = static_cast<char*>(front.iov_base) + remaining;
+      front.iov_len -= remaining;
+    }
+  }
+  return true;
+}
+
+inline bool write_file(const std::string& filename, const std::string& header,
+                       const void* data, std::size_t size) {
+  const int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  iovec iov[] = {
+      {const_cast<char*>(header.data()), header.size()},
+      {const_cast<void*>(data), size},
+  };
+  const bool ok = write_all(fd, iov);
+  return ::close(fd) == 0 && ok;
+}
+
+}  // namespace detail
+
+// binary P6, top row first
+inline bool write_ppm(const std::string& filename, std::uint32_t width,
+                      std::uint32_t height, std::span<const color3b> pixels) {
+  static_assert(sizeof(color3b) == 3, "pixels are written as packed RGB");
+  const std::string header = "P6\n" + std::to_string(width) + ' ' +
+                             std::to_string(height) + "\n255\n";
+  return detail::write_file(filename, header, pixels.data(),
+                            pixels.size_bytes());
+}
+
+// headerless packed RGB
+inline bool write_raw(const std::string& filename,
+                      std::span<const color3b> pixels) {
+  return detail::write_file(filename, {}, pixels.data(), pixels.size_bytes());
+}
+
+// Float PFM from linear radiance: each pixel is multiplied by `scale` (e.g.
+// 1 / spp for sample sums) and written bottom row first in host byte order,
+// which the sign of the header scale records.
+inline bool write_pfm(const std::string& filename, std::uint32_t width,
+                      std::uint32_t height, std::span<const color3f> radiance,
+                      float scale = 1.0f) {
+  static_assert(sizeof(color3f) == 3 * sizeof(float));
+  const std::string header =
+      "PF\n" + std::to_string(width) + ' ' + std::to_string(height) + '\n' +
+      (std::endian::native == std::endian::little ? "-1.0\n" : "1.0\n");
+
+  std::vector<color3f> flipped(radiance.size());
+  for (std::uint32_t y = 0; y < height; ++y) {
+    const auto* src = radiance.data() + std::size_t(height - 1 - y) * width;
+    auto* dst = flipped.data() + std::size_t(y) * width;
+    for (std::uint32_t x = 0; x < width; ++x) dst[x] = src[x] * scale;
+  }
+  return detail::write_file(filename, header, flipped.data(),
+                            flipped.size() * sizeof(color3f));
+}
+
+}  // namespace yk::pnm
+
+#endif  // !YK_RAYTRACING_PNM_H
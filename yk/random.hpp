@@ -12,6 +12,7 @@
 #include <utility>
 
 #include "concepts.hpp"
+#include "hash.hpp"
 
 namespace yk {
 
@@ -40,6 +41,27 @@ struct xor128 {
   }
 };
 
+// SplitMix64 : a counter hashed by the splitmix64 finalizer. Its whole state
+// is one word, so seeding costs nothing and a draw is a few multiplies, which
+// keeps constant evaluation cheap; each draw yields a full 64-bit word.
+struct splitmix64 {
+  std::uint64_t state;
+
+  using result_type = std::uint64_t;
+  constexpr static result_type min() {
+    return std::numeric_limits<result_type>::min();
+  }
+  constexpr static result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  constexpr explicit splitmix64(std::uint64_t seed) : state(seed) {}
+
+  constexpr result_type operator()() {
+    return hash::mix(state += 0x9e3779b97f4a7c15ULL);
+  }
+};
+
 template <typename UIntType, size_t w, size_t n, size_t m, size_t r, UIntType a,
           size_t u, UIntType d, size_t s, UIntType b, size_t t, UIntType c,
           size_t l, UIntType f>
@@ -167,7 +189,11 @@ constexpr RealType generate_canonical(UniformRandomNumberGenerator& urng) {
       static_cast<size_t>(std::numeric_limits<RealType>::digits), bits);
   const long double r = static_cast<long double>(urng.max()) -
                         static_cast<long double>(urng.min()) + 1.0L;
-  const size_t log2r = std::bit_width(static_cast<size_t>(r));
+  // bits per draw; r itself does not fit an integer for 64-bit engines
+  using uint_type =
+      std::make_unsigned_t<typename UniformRandomNumberGenerator::result_type>;
+  const size_t log2r =
+      std::bit_width(static_cast<uint_type>(urng.max() - urng.min()));
   const size_t m = std::max<size_t>(1UL, (b + log2r - 1UL) / log2r);
   RealType ret;
   RealType sum = RealType(0);
@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_RAY_PACKET_H
+#define YK_RAYTRACING_RAY_PACKET_H
+
+#include <array>
+#include <cstddef>
+
+#include "concepts.hpp"
+#include "ray.hpp"
+#include "vec3.hpp"
+
+namespace yk {
+
+namespace concepts {
+
+template <std::size_t N>
+concept packet_size = N == 4 || N == 8 || N == 16;
+
+}  // namespace concepts
+
+// N rays stored as structure of arrays, one array per coordinate, so a loop
+// over the lanes reads each coordinate contiguously and can be vectorized.
+template <concepts::arithmetic T, std::size_t N>
+  requires concepts::packet_size<N>
+struct ray_packet {
+  static constexpr std::size_t size = N;
+
+  std::array<T, N> origin_x, origin_y, origin_z;
+  std::array<T, N> direction_x, direction_y, direction_z;
+
+  constexpr ray<T> operator[](std::size_t i) const {
+    return {pos3<T, world_tag>(origin_x[i], origin_y[i], origin_z[i]),
+            vec3<T>(direction_x[i], direction_y[i], direction_z[i])};
+  }
+
+  constexpr void set(std::size_t i, const ray<T>& r) {
+    origin_x[i] = r.origin.x;
+    origin_y[i] = r.origin.y;
+    origin_z[i] = r.origin.z;
+    direction_x[i] = r.direction.x;
+    direction_y[i] = r.direction.y;
+    direction_z[i] = r.direction.z;
+  }
+};
+
+}  // namespace yk
+
+#endif  // !YK_RAYTRACING_RAY_PACKET_H
@@ -2,38 +2,74 @@
 
 #ifndef YK_RAYTRACING_RAYTRACER_H
 
-#include <iostream>
 #include <limits>
+#include <optional>
 #include <type_traits>
 
 #include "concepts.hpp"
 #include "hittable.hpp"
+#include "logger.hpp"
 #include "ray.hpp"
+#include "stats.hpp"
 #include "vec3.hpp"
 
 namespace yk {
 
 template <concepts::arithmetic T, concepts::arithmetic U>
 struct raytracer {
+  // Follows the path iteratively, carrying the product of the attenuations
+  // instead of recursing, so the bounce chain is one loop rather than `depth`
+  // nested calls each holding its hit and scatter results.
   template <concepts::hittable<T> H, std::uniform_random_bit_generator Gen>
-  constexpr color3<U> ray_color(const ray<T>& r, const H& world,
-                                unsigned int depth, Gen& gen) const {
-    if (!std::is_constant_evaluated() && verbose > 2)
-      std::cout << "ray { origin : (" << r.origin.x << ", " << r.origin.y
-                << ", " << r.origin.z << "), direction : (" << r.direction.x
-                << ", " << r.direction.y << ", " << r.direction.z << ") }"
-                << '\n';
-    if (depth == 0) return color3<U>(0, 0, 0);
-    if (auto rec = world.hit(r, 0.001, std::numeric_limits<T>::infinity());
-        rec) {
-      if (auto opt = world.template scatter<U>(r, rec.value(), gen); opt) {
-        const auto& [attenuation, scattered] = opt.value();
-        return attenuation * ray_color(scattered, world, depth - 1, gen);
-      } else
+  constexpr color3<U> ray_color(ray<T> r, const H& world, unsigned int depth,
+                                Gen& gen) const {
+    return trace(r, std::nullopt, world, depth, gen);
+  }
+
+  // The same path, whose first intersection (t_min 0.001, no t_max) was
+  // already found, e.g. by a packet of primary rays; a `first_hit` whose t is
+  // no_hit<T> is a miss.
+  template <concepts::hittable<T> H, std::uniform_random_bit_generator Gen>
+  constexpr color3<U> ray_color(ray<T> r, const hit_candidate<T>& first_hit,
+                                const H& world, unsigned int depth,
+                                Gen& gen) const {
+    return trace(r, first_hit, world, depth, gen);
+  }
+
+ private:
+  template <concepts::hittable<T> H, std::uniform_random_bit_generator Gen>
+  constexpr color3<U> trace(ray<T> r, std::optional<hit_candidate<T>> first_hit,
+                            const H& world, unsigned int depth,
+                            Gen& gen) const {
+    color3<U> throughput(1, 1, 1);
+    for (;; --depth) {
+      if (log::enabled(3))
+        log::write(3,
+                   "ray { origin : (%g, %g, %g), direction : (%g, %g, %g) }\n",
+                   double(r.origin.x), double(r.origin.y), double(r.origin.z),
+                   double(r.direction.x), double(r.direction.y),
+                   double(r.direction.z));
+      if (depth == 0) {
+        stats::add(stats::counter::depth_terminations);
         return color3<U>(0, 0, 0);
+      }
+      std::optional<hit_record<T>> rec;
+      if (first_hit) {
+        if (first_hit->t != no_hit<T>) rec = world.finalize(r, *first_hit);
+        first_hit.reset();
+      } else {
+        rec = world.hit(r, 0.001, std::numeric_limits<T>::infinity());
+      }
+      if (!rec) break;
+      const auto scattered = world.template scatter<U>(r, *rec, gen);
+      if (!scattered) return color3<U>(0, 0, 0);
+      stats::add(stats::counter::bounce_rays);
+      throughput *= scattered->first;
+      r = scattered->second;
     }
     auto t = (r.direction.normalized().y + 1.0) / 2;
-    return (1.0 - t) * color3<U>(1.0, 1.0, 1.0) + t * color3<U>(0.5, 0.7, 1.0);
+    return throughput * ((1.0 - t) * color3<U>(1.0, 1.0, 1.0) +
+                         t * color3<U>(0.5, 0.7, 1.0));
   }
 };
 
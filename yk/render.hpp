@@ -0,0 +1,521 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_RENDER_H
+#define YK_RAYTRACING_RENDER_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if YK_ENABLE_PARALLEL
+#include <execution>
+#endif  // YK_ENABLE_PARALLEL
+
+#include "band_pipeline.hpp"
+#include "camera.hpp"
+#include "cartesian_product.hpp"
+#include "color.hpp"
+#include "concepts.hpp"
+#include "config.hpp"
+#include "framebuffer.hpp"
+#include "hash.hpp"
+#include "heatmap.hpp"
+#include "hittable_list.hpp"
+#include "logger.hpp"
+#include "mapped_output.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "ray_packet.hpp"
+#include "raytracer.hpp"
+#include "sphere.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "vec3.hpp"
+
+#if YK_ENABLE_PARALLEL
+#define YK_EXEC_PAR std::execution::par,
+#else
+#define YK_EXEC_PAR
+#endif  // YK_ENABLE_PARALLEL
+
+#ifndef YK_IMAGE_WIDTH
+#define YK_IMAGE_WIDTH 400
+#endif  // !YK_IMAGE_WIDTH
+
+#ifndef YK_SPP
+#define YK_SPP 100
+#endif  // !YK_SPP
+
+#ifndef YK_MAX_DEPTH
+#define YK_MAX_DEPTH 50
+#endif  // !YK_MAX_DEPTH
+
+// primary rays traced together by the runtime renders : 4, 8 or 16
+#ifndef YK_PACKET_SIZE
+#define YK_PACKET_SIZE 8
+#endif  // !YK_PACKET_SIZE
+
+// YK_SEED, when defined, makes every build deterministic by default
+
+// The scene, the per-pixel renderer and the render loops shared by the
+// program and the benchmarks.
+
+namespace yk {
+
+namespace constants {
+
+constexpr double aspect_ratio = 16.0 / 9.0;
+
+constexpr std::uint32_t height_of(std::uint32_t width) {
+  return static_cast<std::uint32_t>(width / aspect_ratio);
+}
+
+constexpr std::uint32_t image_width = YK_IMAGE_WIDTH;
+constexpr std::uint32_t image_height = height_of(image_width);
+constexpr std::uint32_t samples_per_pixel = YK_SPP;
+constexpr std::uint32_t max_depth = YK_MAX_DEPTH;
+constexpr std::size_t packet_size = YK_PACKET_SIZE;
+static_assert(concepts::packet_size<packet_size>,
+              "YK_PACKET_SIZE must be 4, 8 or 16");
+// Compile-time renders without a seed take one from the build time. With
+// YK_SEED the build time never reaches the preprocessed source, so identical
+// settings preprocess to identical text (which the render cache relies on).
+#ifdef YK_SEED
+constexpr std::optional<std::uint64_t> seed = YK_SEED;
+constexpr std::uint64_t build_seed = YK_SEED;
+#else
+constexpr std::optional<std::uint64_t> seed = std::nullopt;
+constexpr std::uint64_t build_seed = [] {
+  constexpr std::string_view time = __TIME__;
+  return std::accumulate(time.begin(), time.end(), std::uint64_t(0));
+}();
+#endif  // YK_SEED
+
+}  // namespace constants
+
+using color = color3d;
+
+// defaults come from the compile-time constants; the runtime builds may
+// override them from the command line
+struct render_config {
+  std::uint32_t image_width = constants::image_width;
+  std::uint32_t image_height = constants::image_height;
+  std::uint32_t samples_per_pixel = constants::samples_per_pixel;
+  std::uint32_t max_depth = constants::max_depth;
+  framebuffer_backing backing = framebuffer_backing::heap;
+  // Seeds every sample from (seed, pixel, sample), so the image depends on
+  // nothing else. Without one each sample draws from std::random_device; the
+  // compile-time build uses constants::build_seed.
+  std::optional<std::uint64_t> seed = constants::seed;
+
+  constexpr std::size_t pixel_count() const {
+    return std::size_t(image_width) * image_height;
+  }
+};
+
+#if YK_ENABLE_CONSTEXPR
+using image_t =
+    std::array<color3b, constants::image_width * constants::image_height>;
+#else
+using image_t = framebuffer;
+#endif  // YK_ENABLE_CONSTEXPR
+
+YK_CONSTEXPR image_t make_image([[maybe_unused]] const render_config& config) {
+#if YK_ENABLE_CONSTEXPR
+  return {};
+#else
+  return image_t(config.image_width, config.image_height, config.backing);
+#endif  // YK_ENABLE_CONSTEXPR
+}
+
+template <concepts::arithmetic T>
+constexpr color3b to_color3b(const color3<T>& from,
+                             std::uint32_t samples_per_pixel) {
+  auto [r, g, b] = from / samples_per_pixel;
+  color3<T> color = {
+      .r = math::sqrt(r),
+      .g = math::sqrt(g),
+      .b = math::sqrt(b),
+  };
+  return (color.clamped(0.0, 0.999) * 256).template to<uint8_t>();
+}
+
+template <std::ranges::input_range R, std::copy_constructible F>
+constexpr auto for_each(R&& range, F func) {
+  return std::for_each(YK_EXEC_PAR std::ranges::begin(range),
+                       std::ranges::end(range), func);
+}
+
+// field width for a coordinate below `extent` in verbose output
+inline int log_width(std::uint32_t extent) {
+  return std::max(0, static_cast<int>(std::ceil(std::log10(extent))) - 1);
+}
+
+// visits the pixels of rows [first_row, last_row)
+template <std::copy_constructible F>
+constexpr void for_each_pixel(const render_config& config,
+                              std::uint32_t first_row, std::uint32_t last_row,
+                              F func) {
+  for_each(
+      views::cartesian_product(std::views::iota(first_row, last_row),
+                               std::views::iota(0u, config.image_width)),
+      [&](auto yx) {
+        const auto& [y, x] = yx;
+
+        if (log::enabled(1))
+          log::write(1, "(row,col) : (%*u,%*u)\n",
+                     log_width(config.image_height), y,
+                     log_width(config.image_width), x);
+
+        if (trace::enabled()) {
+          const auto begin = trace::now();
+          func(y, x);
+          trace::extend("row", y, begin, trace::now());
+        } else {
+          func(y, x);
+        }
+      });
+}
+
+template <std::copy_constructible F>
+constexpr void for_each_pixel(const render_config& config, F func) {
+  for_each_pixel(config, 0, config.image_height, func);
+}
+
+// Visits the rows [first_row, last_row) in runs of up to N neighbouring
+// pixels : func(y, x, n) covers the pixels [x, x + n) of row y.
+template <std::size_t N, std::copy_constructible F>
+constexpr void for_each_packet(const render_config& config,
+                               std::uint32_t first_row, std::uint32_t last_row,
+                               F func) {
+  const auto packets = std::uint32_t((config.image_width + N - 1) / N);
+  for_each(views::cartesian_product(std::views::iota(first_row, last_row),
+                                    std::views::iota(0u, packets)),
+           [&](auto yp) {
+             const auto& [y, p] = yp;
+             const auto x = std::uint32_t(p * N);
+             const auto n = std::min(std::uint32_t(N), config.image_width - x);
+
+             if (log::enabled(1)) {
+               for (std::uint32_t i = 0; i < n; ++i)
+                 log::write(1, "(row,col) : (%*u,%*u)\n",
+                            log_width(config.image_height), y,
+                            log_width(config.image_width), x + i);
+             }
+
+             if (trace::enabled()) {
+               const auto begin = trace::now();
+               func(y, x, n);
+               trace::extend("row", y, begin, trace::now());
+             } else {
+               func(y, x, n);
+             }
+           });
+}
+
+template <concepts::arithmetic T = double>
+constexpr auto make_world() {
+  return hittable_list<T>{}
+      .add(sphere(pos3<T, world_tag>(0, 0, -1), 0.5,
+                  lambertian<color::value_type>({0.7, 0.3, 0.3})))
+      .add(sphere(pos3<T, world_tag>(0, -100.5, -1), 100.0,
+                  lambertian<color::value_type>({0.8, 0.8, 0.0})))
+      .add(sphere(pos3<T, world_tag>(-1.0, 0.0, -1.0), 0.5,
+                  metal<color::value_type>({0.8, 0.8, 0.8})))
+      .add(sphere(pos3<T, world_tag>(1.0, 0.0, -1.0), 0.5,
+                  metal<color::value_type>({0.8, 0.6, 0.2})));
+}
+
+inline std::uint64_t random_seed() {
+  std::random_device device;
+  return (std::uint64_t(device()) << 32) | device();
+}
+
+template <concepts::arithmetic T = double>
+struct renderer {
+  constexpr explicit renderer(const render_config& config) : config(config) {}
+
+  // Returns the sum (not the average) of the samples [first, last) of (y, x).
+  // The samples are summed in order, so a seeded image comes out bit for bit
+  // the same whichever thread renders the pixel.
+  constexpr color sample_pixel(std::uint32_t y, std::uint32_t x,
+                               std::uint32_t first, std::uint32_t last) const {
+    const std::uint64_t pixel = std::uint64_t(y) * config.image_width + x;
+    color sum(0, 0, 0);
+    for (std::uint32_t s = first; s < last; ++s) {
+      if (log::enabled(2))
+        log::write(2, "(row,col,sam) : (%*u,%*u,%*u)\n",
+                   log_width(config.image_height), y,
+                   log_width(config.image_width), x,
+                   log_width(config.samples_per_pixel), s);
+
+      stats::add(stats::counter::primary_rays);
+
+      const std::uint64_t frame_seed =
+          config.seed.value_or(constants::build_seed);
+      splitmix64 gen(config.seed || std::is_constant_evaluated()
+                         ? hash::sample_seed(frame_seed, pixel, s)
+                         : random_seed());
+      uniform_real_distribution<T> dist(0, 1);
+
+      auto u = (x + dist(gen)) / config.image_width;
+      auto v = (config.image_height - y - 1 + dist(gen)) / config.image_height;
+      sum += tracer.ray_color(cam.get_ray(u, v), world, config.max_depth, gen);
+    }
+    return sum;
+  }
+
+  // sample_pixel() of the n <= N pixels [x, x + n) of row y. Each sample
+  // intersects the primary rays of the n pixels with the world as one packet
+  // and follows every path on its own from there; the sums come out bit for
+  // bit as sample_pixel() returns them. Lanes past n repeat the last pixel.
+  template <std::size_t N>
+  constexpr std::array<color, N> sample_packet(std::uint32_t y,
+                                               std::uint32_t x,
+                                               std::uint32_t n,
+                                               std::uint32_t first,
+                                               std::uint32_t last) const {
+    const std::uint64_t frame_seed =
+        config.seed.value_or(constants::build_seed);
+    std::array<color, N> sums;
+    sums.fill(color(0, 0, 0));
+    for (std::uint32_t s = first; s < last; ++s) {
+      const auto lane_x = [&](std::size_t i) {
+        return x + std::min(std::uint32_t(i), n - 1);
+      };
+      auto gens = [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+        return std::array{splitmix64(
+            config.seed || std::is_constant_evaluated()
+                ? hash::sample_seed(
+                      frame_seed,
+                      std::uint64_t(y) * config.image_width + lane_x(Is), s)
+                : random_seed())...};
+      }(std::make_index_sequence<N>());
+
+      ray_packet<T, N> rays;
+      for (std::size_t i = 0; i < N; ++i) {
+        uniform_real_distribution<T> dist(0, 1);
+        auto u = (lane_x(i) + dist(gens[i])) / config.image_width;
+        auto v = (config.image_height - y - 1 + dist(gens[i])) /
+                 config.image_height;
+        rays.set(i, cam.get_ray(u, v));
+      }
+
+      std::array<hit_candidate<T>, N> hits;
+      hits.fill({no_hit<T>, 0});
+      world.intersect(rays, 0.001, hits);
+
+      for (std::uint32_t i = 0; i < n; ++i) {
+        if (log::enabled(2))
+          log::write(2, "(row,col,sam) : (%*u,%*u,%*u)\n",
+                     log_width(config.image_height), y,
+                     log_width(config.image_width), x + i,
+                     log_width(config.samples_per_pixel), s);
+
+        stats::add(stats::counter::primary_rays);
+
+        sums[i] += tracer.ray_color(rays[i], hits[i], world, config.max_depth,
+                                    gens[i]);
+      }
+    }
+    return sums;
+  }
+
+  render_config config;
+  raytracer<T, double> tracer = {};
+  camera<T> cam = {};
+  decltype(make_world<T>()) world = make_world<T>();
+};
+
+template <concepts::arithmetic T>
+constexpr renderer<T> make_renderer(const render_config& config) {
+  const trace::scope scope("scene build");
+  return renderer<T>(config);
+}
+
+// Calls store(y, x, sum) with the sum of the samples [first, last) of every
+// pixel of rows [first_row, last_row), tracing packets of primary rays.
+template <concepts::arithmetic T, std::copy_constructible F>
+constexpr void for_each_pixel_sum(const renderer<T>& r,
+                                  std::uint32_t first_row,
+                                  std::uint32_t last_row, std::uint32_t first,
+                                  std::uint32_t last, F store) {
+  constexpr auto N = constants::packet_size;
+  for_each_packet<N>(r.config, first_row, last_row,
+                     [&](std::uint32_t y, std::uint32_t x, std::uint32_t n) {
+                       const auto sums =
+                           r.template sample_packet<N>(y, x, n, first, last);
+                       for (std::uint32_t i = 0; i < n; ++i)
+                         store(y, x + i, sums[i]);
+                     });
+}
+
+// where render() records what each pixel cost; empty `cost` disables it
+struct cost_capture {
+  heatmap::metric metric = heatmap::metric::cycles;
+  std::span<float> cost;
+};
+
+template <concepts::arithmetic T = double>
+YK_CONSTEXPR image_t render(const render_config& config = {},
+                            const cost_capture& capture = {}) {
+  const trace::scope scope("render");
+  const auto r = make_renderer<T>(config);
+
+  if (!std::is_constant_evaluated()) std::cout << "rendering..." << std::endl;
+
+  image_t image = make_image(config);
+
+  const auto store = [&](std::uint32_t y, std::uint32_t x, const color& sum) {
+    const auto i = y * config.image_width + x;
+    // parallel access to different element in the same vector is safe
+#if !YK_ENABLE_CONSTEXPR
+    image.accumulation()[i] = sum.template to<float>();
+#endif  // !YK_ENABLE_CONSTEXPR
+    image[i] = to_color3b(sum, config.samples_per_pixel);
+  };
+
+  // A single pass taking every sample of a pixel at once. Measuring the cost
+  // of each pixel, and the compile-time build, trace pixel by pixel.
+  if (!std::is_constant_evaluated() && capture.cost.empty()) {
+    for_each_pixel_sum(r, 0, config.image_height, 0, config.samples_per_pixel,
+                       store);
+  } else {
+    for_each_pixel(config, [&](std::uint32_t y, std::uint32_t x) {
+      color sum(0, 0, 0);
+      const auto trace = [&] {
+        sum = r.sample_pixel(y, x, 0, config.samples_per_pixel);
+      };
+      if (!std::is_constant_evaluated())
+        capture.cost[y * config.image_width + x] =
+            heatmap::measure(capture.metric, trace);
+      else
+        trace();
+      store(y, x, sum);
+    });
+  }
+
+  if (!std::is_constant_evaluated()) {
+    log::flush();
+    std::cout << "rendering finished" << std::endl;
+  }
+
+  return image;
+}
+
+#if !YK_ENABLE_CONSTEXPR
+
+// Renders band after band into the pipeline's buffers; the consumer (e.g. a
+// streaming encoder) works on band n while band n + 1 is traced.
+template <concepts::arithmetic T = double>
+void render_bands(band_pipeline& pipeline, const render_config& config = {}) {
+  const auto r = make_renderer<T>(config);
+
+  std::cout << "rendering..." << std::endl;
+
+  for (std::uint32_t first = 0; first < config.image_height;
+       first += pipeline.band_height()) {
+    const auto last =
+        std::min(first + pipeline.band_height(), config.image_height);
+    framebuffer& band = pipeline.acquire();
+    for_each_pixel_sum(
+        r, first, last, 0, config.samples_per_pixel,
+        [&](std::uint32_t y, std::uint32_t x, const color& sum) {
+          const auto i = (y - first) * config.image_width + x;
+          band.accumulation()[i] = sum.template to<float>();
+          band[i] = to_color3b(sum, config.samples_per_pixel);
+        });
+    pipeline.submit(first, last - first);
+  }
+  pipeline.finish();
+
+  log::flush();
+  std::cout << "rendering finished" << std::endl;
+}
+
+// Workers convert every pixel and store it straight into the mapped output
+// file; there is no intermediate image.
+template <concepts::arithmetic T = double>
+void render_mapped(mapped_output& output, const render_config& config = {}) {
+  const auto r = make_renderer<T>(config);
+
+  std::cout << "rendering..." << std::endl;
+
+  for_each_pixel_sum(
+      r, 0, config.image_height, 0, config.samples_per_pixel,
+      [&](std::uint32_t y, std::uint32_t x, const color& sum) {
+        if (output.layout() == mapped_layout::pfm)
+          output.store(x, y,
+                       (sum / config.samples_per_pixel).template to<float>());
+        else
+          output.store(x, y, to_color3b(sum, config.samples_per_pixel));
+      });
+
+  log::flush();
+  std::cout << "rendering finished" << std::endl;
+}
+
+struct progressive_result {
+  image_t image;
+  std::uint32_t samples_per_pixel;
+};
+
+// Renders one sample per pixel per pass until the next pass would overrun the
+// budget. At least one pass is always taken.
+template <concepts::arithmetic T = double, class Rep, class Period>
+progressive_result render_progressive(
+    std::chrono::duration<Rep, Period> budget,
+    const render_config& config = {}) {
+  using clock = std::chrono::steady_clock;
+  const auto deadline = clock::now() + budget;
+
+  const auto r = make_renderer<T>(config);
+
+  std::cout << "rendering..." << std::endl;
+
+  progressive_result result = {.image = make_image(config)};
+  const auto accumulation = result.image.accumulation();
+  std::ranges::fill(accumulation, color3f(0, 0, 0));
+
+  std::uint32_t samples_per_pixel = 0;
+  for (;;) {
+    const auto pass_begin = clock::now();
+    for_each_pixel_sum(
+        r, 0, config.image_height, samples_per_pixel, samples_per_pixel + 1,
+        [&](std::uint32_t y, std::uint32_t x, const color& sum) {
+          accumulation[y * config.image_width + x] += sum.template to<float>();
+        });
+    ++samples_per_pixel;
+    const auto pass_end = clock::now();
+    if (pass_end + (pass_end - pass_begin) > deadline) break;
+  }
+
+  log::flush();
+  std::cout << "rendering finished" << std::endl;
+
+  result.samples_per_pixel = samples_per_pixel;
+  std::ranges::transform(accumulation, result.image.begin(),
+                         [&](const color3f& c) {
+                           return to_color3b(c, samples_per_pixel);
+                         });
+  return result;
+}
+
+#endif  // !YK_ENABLE_CONSTEXPR
+
+}  // namespace yk
+
+#endif  // !YK_RAYTRACING_RENDER_H
@@ -2,13 +2,19 @@
 #ifndef YK_RAYTRACING_SPHERE_H
 #define YK_RAYTRACING_SPHERE_H
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <random>
+#include <span>
 
 #include "concepts.hpp"
 #include "hittable.hpp"
 #include "material.hpp"
+#include "ray_packet.hpp"
 #include "raytracer.hpp"
+#include "stats.hpp"
 #include "vec3.hpp"
 
 namespace yk {
@@ -22,28 +28,111 @@ struct sphere : public hittable_interface<T, sphere<T, M>> {
   constexpr sphere(pos3<T, world_tag> center, T radius, M material)
       : center(center), radius(radius), material(material) {}
 
-  constexpr std::optional<hit_record<T>> hit_impl(const ray<T>& r, T t_min,
-                                                  T t_max) const {
+  constexpr bool intersect_impl(const ray<T>& r, T t_min,
+                                hit_candidate<T>& closest) const {
+    stats::add(stats::counter::sphere_tests);
     vec3<T> oc = r.origin - center;
     auto a = r.direction.length_squared();
     auto half_b = dot(oc, r.direction);
     auto c = oc.length_squared() - radius * radius;
     auto discriminant = half_b * half_b - a * c;
-    if (discriminant < 0) return std::nullopt;
+    if (discriminant < 0) return false;
     auto sqrtd = math::sqrt(discriminant);
 
     auto root = (-half_b - sqrtd) / a;
-    if (root < t_min || t_max < root) {
+    if (root < t_min || closest.t < root) {
       root = (-half_b + sqrtd) / a;
-      if (root < t_min || t_max < root) return std::nullopt;
+      if (root < t_min || closest.t < root) return false;
     }
 
+    closest = {root, 0};
+    stats::add(stats::counter::sphere_hits);
+    return true;
+  }
+
+  // The same roots as intersect_impl, with the root chosen by selects; the
+  // only branch left skips the rays that miss the sphere entirely.
+  constexpr void intersect_n_impl(std::span<const ray<T>> rays, T t_min,
+                                  std::span<hit_candidate<T>> hits,
+                                  std::uint32_t first_id) const {
+    std::uint64_t found = 0;
+    for (std::size_t i = 0; i < rays.size(); ++i) {
+      const auto& r = rays[i];
+      vec3<T> oc = r.origin - center;
+      auto a = r.direction.length_squared();
+      auto half_b = dot(oc, r.direction);
+      auto c = oc.length_squared() - radius * radius;
+      auto discriminant = half_b * half_b - a * c;
+      if (discriminant < 0) continue;
+      auto sqrtd = math::sqrt(discriminant);
+
+      auto& closest = hits[i];
+      const auto t_near = (-half_b - sqrtd) / a;
+      const auto t_far = (-half_b + sqrtd) / a;
+      const bool near_in = !((t_near < t_min) | (closest.t < t_near));
+      const bool far_in = !((t_far < t_min) | (closest.t < t_far));
+      const bool hit = near_in | far_in;
+      closest.t = hit ? (near_in ? t_near : t_far) : closest.t;
+      closest.id = hit ? first_id : closest.id;
+      found += hit;
+    }
+    stats::add(stats::counter::sphere_tests, rays.size());
+    stats::add(stats::counter::sphere_hits, found);
+  }
+
+  // The packet kernel : a first pass over the lanes computes the quadratic of
+  // every ray without branches, which vectorizes over the SoA packet, and
+  // rejects the whole packet when no ray reaches the sphere. Otherwise the
+  // square roots of all lanes are taken together, and the roots of the
+  // reaching lanes chosen as in intersect_n_impl.
+  template <std::size_t N>
+  constexpr void intersect_packet_impl(const ray_packet<T, N>& rays, T t_min,
+                                       std::array<hit_candidate<T>, N>& hits,
+                                       std::uint32_t first_id) const {
+    std::array<T, N> a, half_b, discriminant;
+    int reaching = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      const auto oc_x = rays.origin_x[i] - center.x;
+      const auto oc_y = rays.origin_y[i] - center.y;
+      const auto oc_z = rays.origin_z[i] - center.z;
+      const auto d_x = rays.direction_x[i];
+      const auto d_y = rays.direction_y[i];
+      const auto d_z = rays.direction_z[i];
+      a[i] = d_x * d_x + d_y * d_y + d_z * d_z;
+      half_b[i] = oc_x * d_x + oc_y * d_y + oc_z * d_z;
+      const auto c = oc_x * oc_x + oc_y * oc_y + oc_z * oc_z - radius * radius;
+      discriminant[i] = half_b[i] * half_b[i] - a[i] * c;
+    }
+    for (std::size_t i = 0; i < N; ++i) reaching |= !(discriminant[i] < 0);
+    stats::add(stats::counter::sphere_tests, N);
+    if (!reaching) return;
+
+    auto sqrtd = discriminant;
+    math::sqrt_each(sqrtd);
+
+    std::uint64_t found = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      auto& closest = hits[i];
+      const auto t_near = (-half_b[i] - sqrtd[i]) / a[i];
+      const auto t_far = (-half_b[i] + sqrtd[i]) / a[i];
+      const bool near_in = !((t_near < t_min) | (closest.t < t_near));
+      const bool far_in = !((t_far < t_min) | (closest.t < t_far));
+      const bool hit = !(discriminant[i] < 0) & (near_in | far_in);
+      closest.t = hit ? (near_in ? t_near : t_far) : closest.t;
+      closest.id = hit ? first_id : closest.id;
+      found += hit;
+    }
+    stats::add(stats::counter::sphere_hits, found);
+  }
+
+  constexpr hit_record<T> finalize_impl(const ray<T>& r,
+                                        const hit_candidate<T>& hit) const {
     hit_record<T> rec = {};
-    rec.t = root;
+    rec.t = hit.t;
+    rec.id = hit.id;
     rec.p = r.at(rec.t);
     auto outward_normal = (rec.p - center) / radius;
     rec.set_face_normal(r, outward_normal);
-
     return rec;
   }
 
@@ -0,0 +1,124 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_STATS_H
+#define YK_RAYTRACING_STATS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace yk::stats {
+
+enum class counter : std::size_t {
+  primary_rays,
+  bounce_rays,
+  sphere_tests,
+  sphere_hits,
+  scatter_rejections,  // metal reflecting below the surface
+  depth_terminations,  // paths cut off by max_depth
+};
+
+inline constexpr std::size_t counter_count = 6;
+
+inline constexpr std::array<std::string_view, counter_count> counter_names = {
+    "primary rays",       "bounce rays",        "sphere tests",
+    "sphere hits",        "scatter rejections", "depth terminations",
+};
+
+struct counters {
+  std::array<std::uint64_t, counter_count> values = {};
+
+  constexpr std::uint64_t operator[](counter c) const {
+    return values[static_cast<std::size_t>(c)];
+  }
+
+  constexpr counters& operator+=(const counters& rhs) {
+    for (std::size_t i = 0; i < counter_count; ++i) values[i] += rhs.values[i];
+    return *this;
+  }
+
+  constexpr std::uint64_t rays() const {
+    return (*this)[counter::primary_rays] + (*this)[counter::bounce_rays];
+  }
+};
+
+namespace detail {
+
+// Every thread counts into its own block; blocks of exited threads are folded
+// into `retired` so nothing is lost when a pool shrinks.
+struct registry {
+  std::mutex mutex;
+  std::vector<counters*> live;
+  counters retired;
+};
+
+inline registry& global_registry() {
+  static registry r;
+  return r;
+}
+
+struct local_counters {
+  counters values;
+
+  local_counters() {
+    auto& r = global_registry();
+    std::lock_guard lock(r.mutex);
+    r.live.push_back(&values);
+  }
+
+  ~local_counters() {
+    auto& r = global_registry();
+    std::lock_guard lock(r.mutex);
+    r.retired += values;
+    std::erase(r.live, &values);
+  }
+};
+
+inline counters& local() {
+  thread_local local_counters c;
+  return c.values;
+}
+
+}  // namespace detail
+
+// a plain thread-local increment; no-op during constant evaluation
+constexpr void add(counter c, std::uint64_t n = 1) {
+  if (!std::is_constant_evaluated())
+    detail::local().values[static_cast<std::size_t>(c)] += n;
+}
+
+// Sums every thread's counters. Call it once the workers are quiescent, e.g.
+// after the parallel algorithm has returned.
+inline counters merge() {
+  auto& r = detail::global_registry();
+  std::lock_guard lock(r.mutex);
+  counters total = r.retired;
+  for (const counters* c : r.live) total += *c;
+  return total;
+}
+
+template <class Rep, class Period>
+void print(std::ostream& os, const counters& c,
+           std::chrono::duration<Rep, Period> elapsed) {
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  os << "statistics :\n";
+  for (std::size_t i = 0; i < counter_count; ++i)
+    os << "  " << std::left << std::setw(20) << counter_names[i] << std::right
+       << c.values[i] << '\n';
+  os << "  " << std::left << std::setw(20) << "render time" << std::right
+     << std::fixed << std::setprecision(3) << seconds << " s\n"
+     << "  " << std::left << std::setw(20) << "throughput" << std::right
+     << std::setprecision(2) << (seconds > 0 ? c.rays() / seconds / 1e6 : 0.0)
+     << " Mrays/s" << std::defaultfloat << std::endl;
+}
+
+}  // namespace yk::stats
+
+#endif  // !YK_RAYTRACING_STATS_H
@@ -0,0 +1,154 @@
+#pragma once
+
+#ifndef YK_RAYTRACING_TRACE_H
+#define YK_RAYTRACING_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Timeline events in the Chrome trace format (chrome://tracing, Perfetto).
+// Every thread appends complete events to its own buffer; nothing is shared
+// while recording, and the buffers are only read by write() once the work
+// has finished. Recording is off until enable() is called.
+
+namespace yk::trace {
+
+namespace detail {
+
+struct event {
+  const char* name;  // a string literal
+  std::int64_t arg;  // < 0 : none
+  std::int64_t begin;
+  std::int64_t end;
+};
+
+struct buffer {
+  std::uint32_t tid;
+  std::vector<event> events;
+};
+
+// buffers outlive their threads so the pool's events survive until write()
+struct registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<buffer>> buffers;
+  std::chrono::steady_clock::time_point origin =
+      std::chrono::steady_clock::now();
+};
+
+inline registry& global_registry() {
+  static registry r;
+  return r;
+}
+
+inline std::atomic<bool> enabled = false;
+
+inline buffer& local() {
+  thread_local buffer* b = [] {
+    auto& r = global_registry();
+    std::lock_guard lock(r.mutex);
+    r.buffers.push_back(std::make_unique<buffer>());
+    r.buffers.back()->tid = static_cast<std::uint32_t>(r.buffers.size());
+    return r.buffers.back().get();
+  }();
+  return *b;
+}
+
+}  // namespace detail
+
+// nanoseconds since the trace origin
+inline std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() -
+             detail::global_registry().origin)
+      .count();
+}
+
+inline void enable() {
+  detail::global_registry();  // fixes the time origin
+  detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+constexpr bool enabled() {
+  return !std::is_constant_evaluated() &&
+         detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Records the span from construction to destruction on the calling thread;
+// `arg` (e.g. a row or group index) is shown with the event when >= 0.
+class scope {
+ public:
+  constexpr explicit scope(const char* name, std::int64_t arg = -1)
+      : name_(name), arg_(arg) {
+    if (enabled()) begin_ = now();
+  }
+
+  scope(const scope&) = delete;
+  scope& operator=(const scope&) = delete;
+
+  constexpr ~scope() {
+    if (begin_ >= 0)
+      detail::local().events.push_back({name_, arg_, begin_, now()});
+  }
+
+ private:
+  const char* name_;
+  std::int64_t arg_;
+  std::int64_t begin_ = -1;
+};
+
+// Records [begin, end) for `arg`, folding it into the thread's previous event
+// when that was the same name and arg and ended less than `gap` before. This
+// turns a stream of per-pixel tasks into one event per run of a row.
+inline void extend(const char* name, std::int64_t arg, std::int64_t begin,
+                   std::int64_t end, std::int64_t gap = 100'000) {
+  auto& events = detail::local().events;
+  if (!events.empty()) {
+    auto& last = events.back();
+    if (last.name == name && last.arg == arg && begin - last.end < gap) {
+      last.end = end;
+      return;
+    }
+  }
+  events.push_back({name, arg, begin, end});
+}
+
+// Writes every buffered event. Call it once the workers are quiescent.
+inline bool write(const std::string& filename) {
+  std::ofstream os(filename);
+  if (!os) return false;
+  const auto micro = [](std::int64_t ns) {
+    return std::to_string(ns / 1000) + '.' +
+           std::to_string(1000 + ns % 1000).substr(1);
+  };
+
+  auto& r = detail::global_registry();
+  std::lock_guard lock(r.mutex);
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& b : r.buffers) {
+    os << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+       << ",\"name\":\"thread_name\",\"args\":{\"name\":\"thread "
+       << b->tid << "\"}}";
+    first = false;
+    for (const auto& e : b->events) {
+      os << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid << ",\"name\":\""
+         << e.name << "\",\"ts\":" << micro(e.begin)
+         << ",\"dur\":" << micro(e.end - e.begin);
+      if (e.arg >= 0) os << ",\"args\":{\"index\":" << e.arg << '}';
+      os << '}';
+    }
+  }
+  os << "\n]}\n";
+  return static_cast<bool>(os.flush());
+}
+
+}  // namespace yk::trace
+
+#endif  // !YK_RAYTRACING_TRACE_H